@@ -4,11 +4,77 @@
 #include "error.h"
 #include "SHARED_EXPORT.h"
 
+class LogSite;
+
 class SHARED_EXPORT ILog
 {
 public:
+    enum OverflowPolicy
+    {
+        // caller waits until writer frees space
+        OVERFLOW_BLOCK,
+        // oldest queued message gives place to new one
+        OVERFLOW_DROP_OLDEST,
+        // new message is dropped
+        OVERFLOW_COUNT_DROPS,
+        DIMENSION_OVERFLOW_POLICY
+    };
+
+    // order matches LOG_LEVEL_* of logging.h
+    enum Level
+    {
+        LEVEL_TRACE,
+        LEVEL_DEBUG,
+        LEVEL_INFO,
+        LEVEL_WARN,
+        LEVEL_ERROR,
+        DIMENSION_LEVEL
+    };
+
+    // tags of arguments packed by LOGF_* macros of logging.h
+    enum ArgType
+    {
+        ARG_INT,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_STRING,
+        DIMENSION_ARG_TYPE
+    };
+
+    // thread-safe in every mode, init() writes under a lock
     static int report(const char* msg);
     static int init(const char* fileName);
+    // every thread queues messages without locks to its own buffer of
+    // capacity (rounded up to power of two) messages; background thread
+    // merges buffers in time order and writes them in batches
+    static int initAsync(const char* fileName, unsigned int capacity = 4096,
+                         OverflowPolicy policy = OVERFLOW_BLOCK);
+    // messages lost to overflow policy since init, dropped ones are
+    // also reported in log itself
+    static unsigned long long getDropped();
+    // asynchronous log writing records instead of text: LOGF_* messages
+    // keep format id, steady clock time and raw arguments, LogDecode
+    // turns file into text; text messages are kept as they are
+    static int initBinary(const char* fileName, unsigned int capacity = 4096,
+                          OverflowPolicy policy = OVERFLOW_BLOCK);
+    // id of call site format, "%1".."%9" of format are replaced by
+    // arguments; location is "file:line", returns 0 on failure
+    static unsigned int registerFormat(const char* location, const char* function,
+                                       const char* format);
+    // args are packed by LOGF_* macros, formatted at once if log is not binary
+    static int reportArgs(unsigned int formatId, const char* args, unsigned int length);
+    // LOG_* macros skip messages below level before formatting them,
+    // every level is enabled by default
+    static int setLevel(Level level);
+    static Level getLevel();
+    static bool isEnabled(Level level);
+    // LOG_* call site went over rate limit, see LogSite of logging.h
+    static void watch(LogSite* site);
+    // reports messages suppressed by LOG_* call sites since their last
+    // reported one, destroy() and asynchronous log writer do it too
+    static void reportSuppressed();
+    // writes every queued message before log is closed, waits for
+    // threads queueing to asynchronous log at the moment
     static void destroy();
 };
 
@@ -0,0 +1,82 @@
+#ifndef IMATRIX_H
+#define IMATRIX_H
+
+#include "error.h"
+#include "SHARED_EXPORT.h"
+#include "IVector.h"
+
+/// \brief Dense matrix of doubles kept row by row
+///
+/// Products go straight to IVector storage when vectors have one
+/// (see IVector::getCoordsPtr), other vectors are copied once.
+class SHARED_EXPORT IMatrix
+{
+public:
+    enum InterfaceTypes
+    {
+        INTERFACE_0,
+        DIMENSION_INTERFACE_IMPL
+    };
+
+    enum Transpose
+    {
+        NO_TRANSPOSE,
+        TRANSPOSE,
+        DIMENSION_TRANSPOSE
+    };
+
+    virtual int getId() const = 0;
+
+    /*factories*/
+    // vals are rows * cols coordinates row by row, may be NULL to get zero matrix
+    static IMatrix* createMatrix(unsigned int rows, unsigned int cols, double const* vals);
+    static IMatrix* createIdentity(unsigned int dim);
+    // non-owning view, vals must outlive matrix, writes go to vals
+    static IMatrix* createView(unsigned int rows, unsigned int cols, double* vals);
+
+    /*operations*/
+    virtual int add(IMatrix const* const right) = 0;
+    virtual int subtract(IMatrix const* const right) = 0;
+    virtual int multiplyByScalar(double scalar) = 0;
+    // y = alpha * op(this) * x + beta * y, beta == 0 ignores old y
+    virtual int multiply(double alpha, IVector const* const x, double beta, IVector* const y,
+                         Transpose trans = NO_TRANSPOSE) const = 0;
+    // this = alpha * op(a) * op(b) + beta * this, a and b may be this
+    virtual int multiply(double alpha, IMatrix const* const a, Transpose transA,
+                         IMatrix const* const b, Transpose transB, double beta) = 0;
+    // this = this + alpha * x * y^T
+    virtual int rank1Update(double alpha, IVector const* const x, IVector const* const y) = 0;
+    // res = x^T * this * y
+    virtual int bilinearForm(IVector const* const x, IVector const* const y, double& res) const = 0;
+
+    /*static operations*/
+    // res = op(left) * op(right)
+    static IMatrix* multiply(IMatrix const* const left, Transpose transLeft,
+                             IMatrix const* const right, Transpose transRight);
+    static IMatrix* transpose(IMatrix const* const matrix);
+
+    /*utils*/
+    virtual unsigned int getRows() const = 0;
+    virtual unsigned int getCols() const = 0;
+    virtual int setElem(unsigned int row, unsigned int col, double elem) = 0;
+    virtual int getElem(unsigned int row, unsigned int col, double& elem) const = 0;
+    // vector viewing row storage, valid while matrix lives, writes go to matrix
+    virtual IVector* getRow(unsigned int row) = 0;
+    // rows * cols coordinates row by row
+    virtual int getElemsPtr(unsigned int& rows, unsigned int& cols, double const*& elems) const = 0;
+    virtual int getMutableElemsPtr(unsigned int& rows, unsigned int& cols, double*& elems) = 0;
+    virtual IMatrix* clone() const = 0;
+
+    /*dtor*/
+    virtual ~IMatrix(){};
+
+protected:
+    IMatrix() = default;
+
+private:
+    /*non default copyable*/
+    IMatrix(const IMatrix& other) = delete;
+    void operator=(const IMatrix& other) = delete;
+};
+
+#endif // IMATRIX_H
@@ -10,9 +10,19 @@ public:
     enum InterfaceTypes
     {
         INTERFACE_0,
+        INTERFACE_F32,
+        INTERFACE_SPARSE,
+        INTERFACE_VIEW,
         DIMENSION_INTERFACE_IMPL
     };
 
+    enum Precision
+    {
+        PRECISION_DOUBLE,
+        PRECISION_FLOAT,
+        DIMENSION_PRECISION
+    };
+
     enum NormType
     {
         NORM_1,
@@ -24,7 +34,22 @@ public:
     virtual int getId() const = 0;
 
     /*factories*/
+    // vals may be NULL to get zero vector
     static IVector* createVector(unsigned int size, double const* vals);
+    // non-owning view, vals must outlive vector, writes go to vals
+    static IVector* createView(unsigned int size, double* vals);
+    // takes ownership of vals allocated with new double[size], even on failure
+    static IVector* adoptVector(unsigned int size, double* vals);
+    // coordinates are kept with given precision, reductions are accumulated in double
+    static IVector* createVector(unsigned int size, double const* vals, Precision precision);
+    // copy of any vector kept with given precision
+    static IVector* convert(IVector const* const vector, Precision precision);
+    // keeps only nnz coordinates, indices must be strictly increasing
+    static IVector* createSparse(unsigned int size, unsigned int nnz, unsigned int const* indices, double const* vals);
+    // non-owning view of parent coordinates offset, offset + stride, ...,
+    // parent must outlive view, reads and writes go to parent
+    static IVector* createSubVector(IVector* const parent, unsigned int offset, unsigned int length,
+                                    unsigned int stride = 1);
 
     /*operations*/
     virtual int add(IVector const* const right) = 0;
@@ -37,6 +62,30 @@ public:
         return ERR_NOT_IMPLEMENTED;
     }
 
+    /*fused operations*/
+    // this = this + alpha * x
+    virtual int axpy(double alpha, IVector const* const x) = 0;
+    // this = alpha * x + beta * this
+    virtual int axpby(double alpha, IVector const* const x, double beta) = 0;
+    // this = sum(coefs[i] * vectors[i]), vectors may contain this
+    virtual int linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors) = 0;
+
+    /*elementwise operations*/
+    // this = |this|
+    virtual int absolute();
+    // this = -1, 0 or 1 by sign of every coordinate
+    virtual int signum();
+    // this = min(max(this, lower), upper)
+    virtual int clamp(IVector const* const lower, IVector const* const upper);
+    // this = min(this, right) coordinate by coordinate
+    virtual int elementwiseMin(IVector const* const right);
+    // this = max(this, right) coordinate by coordinate
+    virtual int elementwiseMax(IVector const* const right);
+    // this = this * right coordinate by coordinate
+    virtual int hadamardProduct(IVector const* const right);
+    // this = this + x * y coordinate by coordinate
+    virtual int fusedMultiplyAdd(IVector const* const x, IVector const* const y);
+
     /*static operations*/
     static IVector* add(IVector const* const left, IVector const* const right);
     static IVector* subtract(IVector const* const left, IVector const* const right);
@@ -47,18 +96,64 @@ public:
         return static_cast<IVector*>(0);
     }
 
+    /*parallelism*/
+    // vectors of at least dim coordinates are processed by several threads,
+    // reductions give the same result for any number of threads
+    static void setParallelThreshold(unsigned int dim);
+    static unsigned int getParallelThreshold();
+    // at most threads threads take part in one operation, 0 means all cores
+    static void setParallelThreads(unsigned int threads);
+    // threads one operation may use now
+    static unsigned int getParallelThreads();
+
+    /*memory*/
+    // coordinate blocks allocated so far by every vector, batch and arena,
+    // they bypass global operator new
+    static unsigned long long getStorageAllocations();
+
     /*comparators*/
     virtual int gt(IVector const* const right, NormType type, bool& result) const = 0;
     virtual int lt(IVector const* const right, NormType type, bool& result) const = 0;
     virtual int eq(IVector const* const right, NormType type, bool& result, double precision) const = 0;
+    // res = norm(this - right) without temporary vector
+    virtual int distance(IVector const* const right, NormType type, double& res) const = 0;
 
     /*utils*/
     virtual unsigned int getDim() const = 0;
     virtual int norm(NormType type, double& res) const = 0;
+    // all three norms in one pass over coordinates
+    virtual int norms(double& norm1, double& norm2, double& normInf) const
+    {
+        int errType;
+        if ((errType = norm(NORM_1, norm1)) != ERR_OK ||
+            (errType = norm(NORM_2, norm2)) != ERR_OK)
+            return errType;
+        return norm(NORM_INF, normInf);
+    }
+    // keeps norms until the vector is changed, so repeated comparisons cost O(1);
+    // fails for views and after getMutableCoordsPtr(), their writes are not tracked;
+    // const calls fill the cache, so such vector must not be read by several threads at once
+    virtual int cacheNorms(bool enable)
+    {
+        return enable ? ERR_NOT_IMPLEMENTED : ERR_OK;
+    }
     virtual int setCoord(unsigned int index, double elem) = 0;
     virtual int getCoord(unsigned int index, double & elem) const = 0;
     virtual int setAllCoords(unsigned int dim, double* coords) = 0;
+    // storage pointers stay valid until the vector itself is changed
     virtual int getCoordsPtr(unsigned int & dim, double const*& elem) const = 0;
+    // contiguous writable storage, fails for implementations without one
+    virtual int getMutableCoordsPtr(unsigned int & dim, double*& elem) = 0;
+    // writable storage for one update made at once, pointer is not kept;
+    // unlike getMutableCoordsPtr() clones may keep sharing and norms caching
+    virtual int getUpdateCoordsPtr(unsigned int & dim, double*& elem)
+    {
+        return getMutableCoordsPtr(dim, elem);
+    }
+    // bytes getCoordsPtr() storage is aligned to, up to 64, 0 without storage;
+    // storage of created vectors is 64, views keep alignment of their vals
+    virtual unsigned int getAlignment() const;
+    // may share storage with the original until either one is changed
     virtual IVector* clone() const = 0;
 
     /*dtor*/
@@ -0,0 +1,77 @@
+#ifndef IVECTORARENA_H
+#define IVECTORARENA_H
+
+#include <cstddef>
+#include "IVector.h"
+#include "SHARED_EXPORT.h"
+
+/// \brief Per-thread arena for short-lived IVectors
+///
+/// Vectors are placed one after another into thread owned slabs.
+/// Deleting such vector is allowed but does not free anything,
+/// memory is reclaimed all at once by reset() to a checkpoint.
+/// Vectors created after the checkpoint must not be used afterwards.
+/// clone() of an arena vector returns a regular heap vector.
+class SHARED_EXPORT IVectorArena
+{
+public:
+    enum InterfaceTypes
+    {
+        INTERFACE_0,
+        DIMENSION_INTERFACE_IMPL
+    };
+
+    virtual int getId() const = 0;
+
+    /*factories*/
+    // arena of calling thread, created on first use
+    static IVectorArena* getThreadArena();
+
+    // vals may be NULL to get zero vector
+    virtual IVector* createVector(unsigned int size, double const* vals) = 0;
+    virtual IVector* clone(IVector const* const vector) = 0;
+
+    /*checkpoints*/
+    virtual size_t checkpoint() const = 0;
+    virtual int reset(size_t checkpoint) = 0;
+
+    /// \brief Frees everything allocated in arena during its lifetime
+    class Scope
+    {
+    public:
+        explicit Scope(IVectorArena* arena = getThreadArena())
+          : m_arena(arena),
+            m_checkpoint(arena ? arena->checkpoint() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (m_arena)
+                m_arena->reset(m_checkpoint);
+        }
+
+        IVectorArena* arena() const { return m_arena; }
+
+    private:
+        IVectorArena* const m_arena;
+        const size_t m_checkpoint;
+
+        /*non default copyable*/
+        Scope(const Scope& other) = delete;
+        void operator=(const Scope& other) = delete;
+    };
+
+protected:
+    /*dtor*/
+    virtual ~IVectorArena(){};
+
+    IVectorArena() = default;
+
+private:
+    /*non default copyable*/
+    IVectorArena(const IVectorArena& other) = delete;
+    void operator=(const IVectorArena& other) = delete;
+};
+
+#endif // IVECTORARENA_H
@@ -0,0 +1,77 @@
+#ifndef IVECTORBATCH_H
+#define IVECTORBATCH_H
+
+#include "error.h"
+#include "SHARED_EXPORT.h"
+#include "IVector.h"
+
+/// \brief Many vectors of one dimension in a single aligned block
+///
+/// Row-major layout keeps coordinates of every vector together, SoA
+/// layout keeps every coordinate of all vectors together. Rows of
+/// storage are padded to 64 bytes, so every vector (row-major) or every
+/// coordinate (SoA) starts on a cache line. Batch operations go over
+/// the whole block at once instead of calling every vector separately.
+class SHARED_EXPORT IVectorBatch
+{
+public:
+    enum InterfaceTypes
+    {
+        INTERFACE_0,
+        DIMENSION_INTERFACE_IMPL
+    };
+
+    enum Layout
+    {
+        LAYOUT_ROW_MAJOR,
+        LAYOUT_SOA,
+        DIMENSION_LAYOUT
+    };
+
+    virtual int getId() const = 0;
+
+    /*factories*/
+    // vals are count * dim coordinates vector by vector, may be NULL to get zero vectors
+    static IVectorBatch* createBatch(unsigned int count, unsigned int dim, double const* vals,
+                                     Layout layout = LAYOUT_ROW_MAJOR);
+
+    /*operations*/
+    // res[i] = norm(vector i), res has count elements
+    virtual int norms(IVector::NormType type, double* res) const = 0;
+    // res[i] = (vector i, x), res has count elements
+    virtual int dotProduct(IVector const* const x, double* res) const = 0;
+    // vector i = vector i + alpha * x for every i
+    virtual int axpy(double alpha, IVector const* const x) = 0;
+    // vector i = vector i + alpha * (vector i of x) for every i
+    virtual int axpy(double alpha, IVectorBatch const* const x) = 0;
+    virtual int multiplyByScalar(double scalar) = 0;
+
+    /*utils*/
+    virtual unsigned int getCount() const = 0;
+    virtual unsigned int getDim() const = 0;
+    virtual Layout getLayout() const = 0;
+    // view of vector storage, valid while batch lives, writes go to batch;
+    // SoA views are strided and have no getCoordsPtr()
+    virtual IVector* getVector(unsigned int index) = 0;
+    virtual int setVector(unsigned int index, IVector const* const vector) = 0;
+    virtual int setCoord(unsigned int index, unsigned int coord, double elem) = 0;
+    virtual int getCoord(unsigned int index, unsigned int coord, double& elem) const = 0;
+    // coordinate j of vector i is elems[i * ld + j] in row-major layout
+    // and elems[j * ld + i] in SoA layout
+    virtual int getElemsPtr(unsigned int& ld, double const*& elems) const = 0;
+    virtual int getMutableElemsPtr(unsigned int& ld, double*& elems) = 0;
+    virtual IVectorBatch* clone() const = 0;
+
+    /*dtor*/
+    virtual ~IVectorBatch(){};
+
+protected:
+    IVectorBatch() = default;
+
+private:
+    /*non default copyable*/
+    IVectorBatch(const IVectorBatch& other) = delete;
+    void operator=(const IVectorBatch& other) = delete;
+};
+
+#endif // IVECTORBATCH_H
@@ -0,0 +1,244 @@
+#ifndef IVECTOREXPR_H
+#define IVECTOREXPR_H
+
+#include "IVector.h"
+
+/// \brief Lazy arithmetic over IVector
+///
+/// Operators only build a small expression tree, no vector is cloned.
+/// The whole tree is evaluated coordinate by coordinate in one loop
+/// when it is assigned to a vector or materialized:
+///
+///     vexpr::assign(next, vexpr::ref(curr) - alpha * vexpr::ref(grad));
+///     IVector* mid = vexpr::materialize(0.5 * (vexpr::ref(a) + vexpr::ref(b)));
+///
+/// Operands must outlive the expression. Destination may be one of them.
+/// Operands without coordinates storage are read through getCoord(),
+/// all of them are checked before destination is changed.
+namespace vexpr {
+
+template<class E>
+struct Expr
+{
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+/// \brief Leaf, reads coordinates of IVector
+class Ref : public Expr<Ref>
+{
+public:
+    explicit Ref(IVector const* const vector)
+      : m_vector(vector),
+        m_vals(0),
+        m_dim(0),
+        m_status(ERR_OK)
+    {
+        if (!m_vector)
+            return;
+
+        m_dim = m_vector->getDim();
+        unsigned int dim;
+        if (m_vector->getCoordsPtr(dim, m_vals) != ERR_OK)
+            m_vals = 0;
+    }
+
+    unsigned int dim() const { return m_dim; }
+    bool valid() const { return m_vector != 0; }
+
+    // reads every coordinate of vector without storage
+    int check() const
+    {
+        if (m_vals)
+            return ERR_OK;
+
+        double coord;
+        for (unsigned int i = 0; i < m_dim; ++i)
+        {
+            int errType = m_vector->getCoord(i, coord);
+            if (errType != ERR_OK)
+                return errType;
+        }
+        return ERR_OK;
+    }
+
+    // first getCoord() error met by operator[]
+    int status() const { return m_status; }
+
+    double operator[](unsigned int i) const
+    {
+        if (m_vals)
+            return m_vals[i];
+
+        double coord = 0;
+        int errType = m_vector->getCoord(i, coord);
+        if (errType != ERR_OK && m_status == ERR_OK)
+            m_status = errType;
+        return coord;
+    }
+
+private:
+    IVector const* m_vector;
+    double const* m_vals;
+    unsigned int m_dim;
+    mutable int m_status;
+};
+
+struct Plus  { static double apply(double l, double r) { return l + r; } };
+struct Minus { static double apply(double l, double r) { return l - r; } };
+
+template<class L, class R, class Op>
+class Binary : public Expr<Binary<L, R, Op> >
+{
+public:
+    Binary(const L& left, const R& right)
+      : m_left(left),
+        m_right(right)
+    {
+    }
+
+    unsigned int dim() const { return m_left.dim(); }
+
+    bool valid() const
+    {
+        return m_left.valid() && m_right.valid() && m_left.dim() == m_right.dim();
+    }
+
+    int check() const
+    {
+        int errType = m_left.check();
+        return errType != ERR_OK ? errType : m_right.check();
+    }
+
+    int status() const
+    {
+        int errType = m_left.status();
+        return errType != ERR_OK ? errType : m_right.status();
+    }
+
+    double operator[](unsigned int i) const
+    {
+        return Op::apply(m_left[i], m_right[i]);
+    }
+
+private:
+    const L m_left;
+    const R m_right;
+};
+
+template<class E>
+class Scaled : public Expr<Scaled<E> >
+{
+public:
+    Scaled(const E& expr, double scalar)
+      : m_expr(expr),
+        m_scalar(scalar)
+    {
+    }
+
+    unsigned int dim() const { return m_expr.dim(); }
+    bool valid() const { return m_expr.valid(); }
+    int check() const { return m_expr.check(); }
+    int status() const { return m_expr.status(); }
+
+    double operator[](unsigned int i) const
+    {
+        return m_scalar * m_expr[i];
+    }
+
+private:
+    const E m_expr;
+    const double m_scalar;
+};
+
+inline Ref ref(IVector const* const vector)
+{
+    return Ref(vector);
+}
+
+template<class L, class R>
+Binary<L, R, Plus> operator+(const Expr<L>& left, const Expr<R>& right)
+{
+    return Binary<L, R, Plus>(left.self(), right.self());
+}
+
+template<class L, class R>
+Binary<L, R, Minus> operator-(const Expr<L>& left, const Expr<R>& right)
+{
+    return Binary<L, R, Minus>(left.self(), right.self());
+}
+
+template<class E>
+Scaled<E> operator*(double scalar, const Expr<E>& expr)
+{
+    return Scaled<E>(expr.self(), scalar);
+}
+
+template<class E>
+Scaled<E> operator*(const Expr<E>& expr, double scalar)
+{
+    return Scaled<E>(expr.self(), scalar);
+}
+
+template<class E>
+Scaled<E> operator-(const Expr<E>& expr)
+{
+    return Scaled<E>(expr.self(), -1.0);
+}
+
+/// \brief Evaluates expression into existing vector in one pass
+template<class E>
+int assign(IVector* const dst, const Expr<E>& expr)
+{
+    const E& e = expr.self();
+    if (!dst || !e.valid())
+        return ERR_WRONG_ARG;
+
+    if (dst->getDim() != e.dim())
+        return ERR_DIMENSIONS_MISMATCH;
+
+    int errType = e.check();
+    if (errType != ERR_OK)
+        return errType;
+
+    unsigned int dim;
+    double* vals;
+    if (dst->getUpdateCoordsPtr(dim, vals) == ERR_OK)
+    {
+        for (unsigned int i = 0; i < dim; ++i)
+            vals[i] = e[i];
+        return e.status();
+    }
+
+    for (unsigned int i = 0; i < e.dim(); ++i)
+    {
+        errType = dst->setCoord(i, e[i]);
+        if (errType != ERR_OK)
+            return errType;
+    }
+    return e.status();
+}
+
+/// \brief Evaluates expression into new vector
+///
+/// \returns NULL on failure
+template<class E>
+IVector* materialize(const Expr<E>& expr)
+{
+    if (!expr.self().valid())
+        return static_cast<IVector*>(0);
+
+    IVector* res = IVector::createVector(expr.self().dim(), 0);
+    if (!res)
+        return static_cast<IVector*>(0);
+
+    if (assign(res, expr) != ERR_OK)
+    {
+        delete res;
+        return static_cast<IVector*>(0);
+    }
+    return res;
+}
+
+}
+
+#endif // IVECTOREXPR_H
@@ -0,0 +1,69 @@
+#ifndef IVECTORFILE_H
+#define IVECTORFILE_H
+
+#include "IVector.h"
+#include "ISet.h"
+#include "SHARED_EXPORT.h"
+
+/// \brief Vectors of one dimension stored in binary file
+///
+/// File is a 64 byte header followed by coordinates of all vectors
+/// one after another, little-endian, payload aligned to 64 bytes:
+///
+///   offset  size  field
+///        0     8  magic "IVECBIN\0"
+///        8     4  version, 1
+///       12     4  precision, IVector::Precision
+///       16     4  dim
+///       20     4  alignment of payload offset
+///       24     8  count
+///       32     8  payload offset
+///       40     8  stride, bytes between starts of vectors
+///       48    16  reserved, zero
+///
+/// Opened files are mapped into memory, so opening costs the same
+/// for any size and coordinates are paged in on first access.
+class SHARED_EXPORT IVectorFile
+{
+public:
+    enum InterfaceTypes
+    {
+        INTERFACE_0,
+        DIMENSION_INTERFACE_IMPL
+    };
+
+    virtual int getId() const = 0;
+
+    /*writers*/
+    // all vectors must have the same dimension
+    static int save(char const* path, unsigned int count, IVector const* const* vectors,
+                    IVector::Precision precision = IVector::PRECISION_DOUBLE);
+    static int save(char const* path, ISet const* const set,
+                    IVector::Precision precision = IVector::PRECISION_DOUBLE);
+
+    /*loader*/
+    static IVectorFile* open(char const* path);
+
+    virtual unsigned int getDim() const = 0;
+    virtual unsigned int getCount() const = 0;
+    virtual IVector::Precision getPrecision() const = 0;
+    // double files give view of mapped coordinates, valid while file is open,
+    // writes go to private copy of the page; float files give a copy
+    virtual IVector* getVector(unsigned int index) const = 0;
+    // read-only set over mapped coordinates, may outlive file,
+    // put(), remove() and clear() fail
+    virtual ISet* createSet() const = 0;
+
+    /*dtor*/
+    virtual ~IVectorFile(){};
+
+protected:
+    IVectorFile() = default;
+
+private:
+    /*non default copyable*/
+    IVectorFile(const IVectorFile& other) = delete;
+    void operator=(const IVectorFile& other) = delete;
+};
+
+#endif // IVECTORFILE_H
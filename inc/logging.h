@@ -1,24 +1,286 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <ILog.h>
 
+// Severity levels for preprocessor, same order as ILog::Level
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF   5
+
+// Calls below LOG_MIN_LEVEL are removed by preprocessor, define it
+// as LOG_LEVEL_OFF to build without any logging
+#ifndef LOG_MIN_LEVEL
+#  ifdef QT_NO_DEBUG
+#    define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#  else
+#    define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#  endif
+#endif
+
+// Every LOG_* call site reports at most LOG_RATE_BURST messages per
+// LOG_RATE_PERIOD_MS milliseconds, 0 turns limit off
+#ifndef LOG_RATE_BURST
+#  define LOG_RATE_BURST 10
+#endif
+#ifndef LOG_RATE_PERIOD_MS
+#  define LOG_RATE_PERIOD_MS 1000
+#endif
+
 #define S1(x) #x
 #define S2(x) S1(x)
 #define LOCATION \
-  std::string(__FILE__) + ":" + S2(__LINE__) + " [" + __FUNCTION__ + "] "
+  std::string(__FILE__ ":" S2(__LINE__) " [") + __FUNCTION__ + "] "
 
-#define LOG(message) \
-  ILog::report((std::string(LOCATION) + std::string(message)).c_str())
+// Counters of one LOG_* call site: messages over rate limit are only
+// counted, and "suppressed K similar messages" is reported before next
+// message of site or by ILog::reportSuppressed(), which asynchronous
+// log writer calls every LOG_RATE_PERIOD_MS
+class LogSite {
+public:
+  LogSite(const char* location, const char* function)
+    : m_location(location),
+      m_function(function),
+      m_windowStart(0),
+      m_count(0),
+      m_suppressed(0),
+      m_watched(false),
+      m_nextWatched(NULL)
+  {  }
 
-#define LOG_RET(message, ret_val)                  \
-{                                                  \
-  LOG(message);                                    \
-  LOG("Returns " + std::string(#ret_val) + "..."); \
-  return ret_val;                                  \
+  // false if message is over rate limit
+  bool admit()
+  {
+#if LOG_RATE_BURST > 0
+    const long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    long long start = m_windowStart.load(std::memory_order_relaxed);
+    if (now - start >= LOG_RATE_PERIOD_MS &&
+        m_windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+      m_count.store(0, std::memory_order_relaxed);
+
+    if (m_count.load(std::memory_order_relaxed) >= LOG_RATE_BURST ||
+        m_count.fetch_add(1, std::memory_order_relaxed) >= LOG_RATE_BURST) {
+      m_suppressed.fetch_add(1, std::memory_order_relaxed);
+      if (!m_watched.load(std::memory_order_relaxed) &&
+          !m_watched.exchange(true, std::memory_order_relaxed))
+        ILog::watch(this);
+      return false;
+    }
+
+    reportSuppressed();
+#endif
+    return true;
+  }
+
+private:
+  friend class ILog;
+
+  void reportSuppressed()
+  {
+    if (m_suppressed.load(std::memory_order_relaxed) == 0)
+      return;
+    const unsigned long long suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+    if (suppressed > 0)
+      ILog::report((std::string(m_location) + " [" + m_function + "] suppressed " +
+                    std::to_string(suppressed) + " similar messages").c_str());
+  }
+
+  const char*                     m_location;
+  const char*                     m_function;
+  std::atomic<long long>          m_windowStart;
+  std::atomic<unsigned int>       m_count;
+  std::atomic<unsigned long long> m_suppressed;
+  std::atomic<bool>               m_watched;
+  // list of ILog::watch(), set once
+  LogSite*                        m_nextWatched;
+};
+
+// Message is formatted only if level passes ILog::isEnabled() and
+// call site is within rate limit
+#define LOG_AT(level, message)                                        \
+  do {                                                                \
+    if (ILog::isEnabled(level)) {                                     \
+      static LogSite logSite(__FILE__ ":" S2(__LINE__), __FUNCTION__); \
+      if (logSite.admit())                                            \
+        ILog::report((LOCATION + std::string(message)).c_str());      \
+    }                                                                 \
+  } while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+#  define LOG_TRACE(message) LOG_AT(ILog::LEVEL_TRACE, message)
+#else
+#  define LOG_TRACE(message) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#  define LOG_DEBUG(message) LOG_AT(ILog::LEVEL_DEBUG, message)
+#else
+#  define LOG_DEBUG(message) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#  define LOG_INFO(message) LOG_AT(ILog::LEVEL_INFO, message)
+#else
+#  define LOG_INFO(message) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#  define LOG_WARN(message) LOG_AT(ILog::LEVEL_WARN, message)
+#else
+#  define LOG_WARN(message) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#  define LOG_ERROR(message) LOG_AT(ILog::LEVEL_ERROR, message)
+#else
+#  define LOG_ERROR(message) ((void)0)
+#endif
+
+#define LOG(message) LOG_ERROR(message)
+
+// Reports message and returned value as one line
+#define LOG_RET(message, ret_val)                                     \
+{                                                                     \
+  LOG(std::string(message) + ". Returns " #ret_val "...");            \
+  return ret_val;                                                     \
 }
 
+// Format and arguments of LOGF_* call packed as ILog::ArgType tag and
+// raw bytes; strings are cut to fit, arguments after one that does not
+// fit are dropped
+class LogArgs {
+public:
+  template <typename... Args>
+  explicit LogArgs(const char* format, Args const&... args)
+    : m_format(format),
+      m_size(0),
+      m_full(false)
+  {
+    pack(args...);
+  }
+
+  const char* format() const { return m_format; }
+  const char* data() const { return m_data; }
+  unsigned int size() const { return m_size; }
+
+private:
+  static const unsigned int capacity = 200;
+
+  void pack() {  }
+
+  template <typename T, typename... Args>
+  void pack(T const& value, Args const&... args)
+  {
+    put(value);
+    pack(args...);
+  }
+
+  template <typename T>
+  typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) ||
+                          std::is_enum<T>::value>::type
+  put(T value) { putRaw(ILog::ARG_INT, static_cast<long long>(value)); }
+
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+  put(T value) { putRaw(ILog::ARG_UINT, static_cast<unsigned long long>(value)); }
+
+  template <typename T>
+  typename std::enable_if<std::is_floating_point<T>::value>::type
+  put(T value) { putRaw(ILog::ARG_DOUBLE, static_cast<double>(value)); }
+
+  void put(const char* value) { putString(value, value ? std::strlen(value) : 0); }
+  void put(std::string const& value) { putString(value.data(), value.size()); }
+
+  template <typename V>
+  void putRaw(ILog::ArgType type, V value)
+  {
+    if (m_full || capacity - m_size < 1 + sizeof(value)) {
+      m_full = true;
+      return;
+    }
+    m_data[m_size++] = static_cast<char>(type);
+    std::memcpy(m_data + m_size, &value, sizeof(value));
+    m_size += sizeof(value);
+  }
+
+  void putString(const char* value, size_t length)
+  {
+    unsigned short size;
+    if (m_full || capacity - m_size < 1 + sizeof(size)) {
+      m_full = true;
+      return;
+    }
+    size = static_cast<unsigned short>(
+      length < capacity - m_size - 1 - sizeof(size) ? length : capacity - m_size - 1 - sizeof(size));
+    m_data[m_size++] = static_cast<char>(ILog::ARG_STRING);
+    std::memcpy(m_data + m_size, &size, sizeof(size));
+    m_size += sizeof(size);
+    std::memcpy(m_data + m_size, value, size);
+    m_size += size;
+  }
+
+  const char*  m_format;
+  unsigned int m_size;
+  bool         m_full;
+  char         m_data[capacity];
+};
+
+// LOGF_*(format, args...) report format with "%1".."%9" replaced by
+// args; format is registered once per call site, and in binary log
+// (ILog::initBinary) only its id and raw args are written; rate limit
+// is the same as of LOG_*
+#define LOGF_AT(level, ...)                                           \
+  do {                                                                \
+    if (ILog::isEnabled(level)) {                                     \
+      static LogSite logSite(__FILE__ ":" S2(__LINE__), __FUNCTION__); \
+      if (logSite.admit()) {                                          \
+        const LogArgs logArgs(__VA_ARGS__);                           \
+        static const unsigned int logFormatId = ILog::registerFormat( \
+          __FILE__ ":" S2(__LINE__), __FUNCTION__, logArgs.format()); \
+        ILog::reportArgs(logFormatId, logArgs.data(), logArgs.size()); \
+      }                                                               \
+    }                                                                 \
+  } while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+#  define LOGF_TRACE(...) LOGF_AT(ILog::LEVEL_TRACE, __VA_ARGS__)
+#else
+#  define LOGF_TRACE(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#  define LOGF_DEBUG(...) LOGF_AT(ILog::LEVEL_DEBUG, __VA_ARGS__)
+#else
+#  define LOGF_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#  define LOGF_INFO(...) LOGF_AT(ILog::LEVEL_INFO, __VA_ARGS__)
+#else
+#  define LOGF_INFO(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#  define LOGF_WARN(...) LOGF_AT(ILog::LEVEL_WARN, __VA_ARGS__)
+#else
+#  define LOGF_WARN(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#  define LOGF_ERROR(...) LOGF_AT(ILog::LEVEL_ERROR, __VA_ARGS__)
+#else
+#  define LOGF_ERROR(...) ((void)0)
+#endif
+
 struct ScopedILog {
   ScopedILog(const std::string fileName) {
     int result = ILog::init(fileName.c_str());
@@ -0,0 +1,37 @@
+##--------------------------
+## Defines
+##--------------------------
+
+include(_defines.pri)
+
+##--------------------------
+## Project config
+##--------------------------
+
+QT += core
+QT -= gui
+
+TARGET = Benchmark
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+include(_out_paths.pri)
+
+INCLUDEPATH += \
+    $$INC_ROOT
+
+LIBS += \
+  -L$$OUT_ROOT/$$DBG_RLS_SWITCH/log     -llog \
+  -L$$OUT_ROOT/$$DBG_RLS_SWITCH/vector  -lvector
+
+SOURCES += \
+    $$SRC_ROOT/bench_main.cpp
+
+HEADERS += \
+    $$INC_ROOT/IVector.h \
+    $$INC_ROOT/ILog.h \
+    $$INC_ROOT/error.h \
+    $$INC_ROOT/SHARED_EXPORT.h \
+    $$INC_ROOT/logging.h
@@ -0,0 +1,34 @@
+##--------------------------
+## Defines
+##--------------------------
+
+include(_defines.pri)
+
+##--------------------------
+## Project config
+##--------------------------
+
+QT += core
+QT -= gui
+
+TARGET = LogDecode
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+include(_out_paths.pri)
+
+INCLUDEPATH += \
+    $$SRC_ROOT \
+    $$INC_ROOT
+
+SOURCES += \
+    $$SRC_ROOT/logdecode_main.cpp \
+    $$IMP_DIR/log/logformat.cpp
+
+HEADERS += \
+    $$IMP_DIR/log/logformat.h \
+    $$INC_ROOT/ILog.h \
+    $$INC_ROOT/error.h \
+    $$INC_ROOT/SHARED_EXPORT.h
@@ -18,3 +18,7 @@ CONFIG(debug, debug|release) {
 }
 
 QMAKE_CFLAGS += -g
+
+## Lowest LOG_* level compiled in, 0 (trace) .. 4 (error), 5 removes logging;
+## release builds keep info and above by default
+# DEFINES += LOG_MIN_LEVEL=5
@@ -26,9 +26,11 @@ INCLUDEPATH += \
     $$INC_ROOT
 
 SOURCES += \
-    $$IMP_DIR/Log.cpp
+    $$IMP_DIR/Log.cpp \
+    $$IMP_DIR/log/logformat.cpp
 
 HEADERS += \
+    $$IMP_DIR/log/logformat.h \
     $$INC_ROOT/error.h \
     $$INC_ROOT/SHARED_EXPORT.h \
     $$INC_ROOT/ILog.h \
@@ -29,15 +29,24 @@ DEPENDPATH += \
 LIBS += \
   -L$$OUT_ROOT/$$DBG_RLS_SWITCH/log -llog
 
+INCLUDEPATH += \
+  $$OUT_ROOT/$$DBG_RLS_SWITCH/vector
+DEPENDPATH += \
+  $$OUT_ROOT/$$DBG_RLS_SWITCH/vector
+LIBS += \
+  -L$$OUT_ROOT/$$DBG_RLS_SWITCH/vector -lvector
+
 INCLUDEPATH += \
     $$INC_ROOT
 
 SOURCES += \
-    $$IMP_DIR/Set_0.cpp
+    $$IMP_DIR/Set_0.cpp \
+    $$IMP_DIR/VectorFile_0.cpp
 
 HEADERS += \
     $$INC_ROOT/error.h \
     $$INC_ROOT/SHARED_EXPORT.h \
     $$INC_ROOT/logging.h \
     $$INC_ROOT/ISet.h \
-    $$INC_ROOT/IVector.h
+    $$INC_ROOT/IVector.h \
+    $$INC_ROOT/IVectorFile.h
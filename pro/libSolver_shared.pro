@@ -49,4 +49,6 @@ HEADERS += \
     $$INC_ROOT/ICompact.h \
     $$INC_ROOT/IProblem.h \
     $$INC_ROOT/IBrocker.h \
-    $$INC_ROOT/ISolver.h
+    $$INC_ROOT/ISolver.h \
+    $$INC_ROOT/IVector.h \
+    $$INC_ROOT/IVectorArena.h
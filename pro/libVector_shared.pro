@@ -33,10 +33,32 @@ INCLUDEPATH += \
     $$INC_ROOT
 
 SOURCES += \
-    $$IMP_DIR/Vector_0.cpp
+    $$IMP_DIR/Vector_0.cpp \
+    $$IMP_DIR/vector/kernels.cpp \
+    $$IMP_DIR/vector/parallel.cpp \
+    $$IMP_DIR/vector/storage.cpp \
+    $$IMP_DIR/vector/Arena_0.cpp \
+    $$IMP_DIR/vector/Vector_F.cpp \
+    $$IMP_DIR/vector/Vector_Sparse.cpp \
+    $$IMP_DIR/vector/Vector_View.cpp \
+    $$IMP_DIR/vector/blas.cpp \
+    $$IMP_DIR/vector/Matrix_0.cpp \
+    $$IMP_DIR/vector/Batch_0.cpp
+
+HEADERS += \
+    $$IMP_DIR/vector/kernels.h \
+    $$IMP_DIR/vector/blas.h \
+    $$IMP_DIR/vector/parallel.h \
+    $$IMP_DIR/vector/storage.h \
+    $$IMP_DIR/vector/Vector_0.h \
+    $$IMP_DIR/vector/Vector_N.h
 
 HEADERS += \
     $$INC_ROOT/error.h \
     $$INC_ROOT/SHARED_EXPORT.h \
     $$INC_ROOT/logging.h \
-    $$INC_ROOT/IVector.h
+    $$INC_ROOT/IVector.h \
+    $$INC_ROOT/IVectorArena.h \
+    $$INC_ROOT/IVectorExpr.h \
+    $$INC_ROOT/IMatrix.h \
+    $$INC_ROOT/IVectorBatch.h
@@ -0,0 +1,305 @@
+#include <QScopedPointer>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#include <logging.h>
+#include <IVector.h>
+#pragma warning(pop)
+
+#define array_size(array) (sizeof(array)/sizeof(*array))
+
+/// \brief Allocations made through global operator new
+///
+/// Library allocations are counted too where the executable's operator new
+/// replaces the library's one (ELF platforms), otherwise only own ones are.
+/// Coordinate blocks bypass it, see allocationsNow().
+static std::atomic<unsigned long long> allocations(0);
+
+void* operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+  return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+  std::free(ptr);
+}
+
+namespace {
+  /// \brief Keeps results alive, so calls are not optimized out
+  volatile double sink;
+
+  /// \brief Operands of one measured dimension
+  struct Operands
+  {
+    unsigned int dim;
+    QVector<double> vals;
+    IVector* left;
+    IVector* right;
+  };
+
+  typedef void (*Op)(Operands& ops);
+
+  void opCreateVector(Operands& ops)
+  {
+    delete IVector::createVector(ops.dim, ops.vals.data());
+  }
+
+  void opClone(Operands& ops)
+  {
+    delete ops.left->clone();
+  }
+
+  void opAdd(Operands& ops)
+  {
+    ops.left->add(ops.right);
+  }
+
+  void opSubtract(Operands& ops)
+  {
+    ops.left->subtract(ops.right);
+  }
+
+  void opDotProduct(Operands& ops)
+  {
+    double res;
+    ops.left->dotProduct(ops.right, res);
+    sink = res;
+  }
+
+  void opNorm(Operands& ops)
+  {
+    double res;
+    ops.left->norm(IVector::NORM_2, res);
+    sink = res;
+  }
+
+  void opEq(Operands& ops)
+  {
+    bool res;
+    ops.left->eq(ops.right, IVector::NORM_2, res, 1e-9);
+    sink = res;
+  }
+
+  void opStaticAdd(Operands& ops)
+  {
+    delete IVector::add(ops.left, ops.right);
+  }
+
+  void opStaticSubtract(Operands& ops)
+  {
+    delete IVector::subtract(ops.left, ops.right);
+  }
+
+  void opStaticMultiplyByScalar(Operands& ops)
+  {
+    delete IVector::multiplyByScalar(ops.left, 1.5);
+  }
+
+  /// \brief Measured operation
+  ///
+  /// traffic is coordinates read and written by one call as if it copied
+  /// naively, GB/s is derived from it, so shared clones may exceed memory bandwidth.
+  struct Bench
+  {
+    const char* name;
+    Op op;
+    unsigned int traffic;
+  };
+
+  const Bench benches[] = {
+    { "createVector",             opCreateVector,           2 },
+    { "clone",                    opClone,                  2 },
+    { "add",                      opAdd,                    3 },
+    { "subtract",                 opSubtract,               3 },
+    { "dotProduct",               opDotProduct,             2 },
+    { "norm",                     opNorm,                   1 },
+    { "eq",                       opEq,                     2 },
+    { "static add",               opStaticAdd,              3 },
+    { "static subtract",          opStaticSubtract,         3 },
+    { "static multiplyByScalar",  opStaticMultiplyByScalar, 2 },
+  };
+
+  const unsigned int dims[] = {
+    2, 3, 4, 8, 16, 64, 256, 1024, 4096, 16384, 65536,
+    262144, 1048576, 4194304, 10000000
+  };
+
+  struct Result
+  {
+    unsigned long long iterations;
+    double nsPerOp;
+    double allocsPerOp;
+  };
+
+  /// \brief operator new calls and coordinate blocks allocated by library
+  unsigned long long allocationsNow()
+  {
+    return allocations.load(std::memory_order_relaxed) + IVector::getStorageAllocations();
+  }
+
+  /// \brief Doubles iterations until one batch lasts at least minTime seconds
+  Result measure(const Bench& bench, Operands& ops, double minTime)
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    bench.op(ops);
+    Result res = { 0, 0, 0 };
+    for (unsigned long long iterations = 1;; iterations *= 2) {
+      const unsigned long long allocsBefore = allocationsNow();
+      const Clock::time_point start = Clock::now();
+      for (unsigned long long i = 0; i < iterations; ++i)
+        bench.op(ops);
+      const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+      const unsigned long long allocs = allocationsNow() - allocsBefore;
+
+      res.iterations = iterations;
+      res.nsPerOp = elapsed * 1e9 / iterations;
+      res.allocsPerOp = static_cast<double>(allocs) / iterations;
+      if (elapsed >= minTime)
+        return res;
+    }
+  }
+
+  void usage(const char* self)
+  {
+    std::fprintf(stderr,
+                 "usage: %s [--out FILE] [--min-time SECONDS] [--max-dim DIM] [--max-threads N]\n"
+                 "Times IVector operations and prints results as JSON.\n", self);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  ScopedILog logger("benchLog");
+
+  const char* outPath = NULL;
+  double minTime = 0.1;
+  unsigned long maxDim = 10000000;
+  unsigned long maxThreads = 0;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (hasValue && !std::strcmp(argv[i], "--out"))
+      outPath = argv[++i];
+    else if (hasValue && !std::strcmp(argv[i], "--min-time"))
+      minTime = std::atof(argv[++i]);
+    else if (hasValue && !std::strcmp(argv[i], "--max-dim"))
+      maxDim = std::strtoul(argv[++i], NULL, 10);
+    else if (hasValue && !std::strcmp(argv[i], "--max-threads"))
+      maxThreads = std::strtoul(argv[++i], NULL, 10);
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  IVector::setParallelThreads(0);
+  unsigned int cores = IVector::getParallelThreads();
+  if (maxThreads > 0 && maxThreads < cores)
+    cores = static_cast<unsigned int>(maxThreads);
+  const unsigned int threshold = IVector::getParallelThreshold();
+
+  std::FILE* out = outPath ? std::fopen(outPath, "w") : stdout;
+  if (!out) {
+    std::fprintf(stderr, "Failed to open %s\n", outPath);
+    return 1;
+  }
+
+  std::fprintf(out, "{\n  \"threads\": %u,\n  \"parallelThreshold\": %u,\n  \"minTime\": %g,\n  \"results\": [",
+               cores, threshold, minTime);
+
+  bool first = true;
+  for (size_t d = 0; d < array_size(dims) && dims[d] <= maxDim; ++d) {
+    Operands ops;
+    ops.dim = dims[d];
+    ops.vals.resize(static_cast<int>(ops.dim));
+    for (unsigned int i = 0; i < ops.dim; ++i)
+      ops.vals[i] = 1.0 + (i % 7) * 0.125;
+
+    QScopedPointer<IVector> left(IVector::createVector(ops.dim, ops.vals.data()));
+    QScopedPointer<IVector> right(IVector::createVector(ops.dim, ops.vals.data()));
+    if (!left || !right) {
+      std::fprintf(stderr, "Not enough memory for dimension %u\n", ops.dim);
+      break;
+    }
+    ops.left = left.data();
+    ops.right = right.data();
+
+    for (unsigned int threads = 1;; threads = threads * 2 < cores ? threads * 2 : cores) {
+      IVector::setParallelThreads(threads);
+      for (size_t b = 0; b < array_size(benches); ++b) {
+        const Result res = measure(benches[b], ops, minTime);
+        const double bytes = 8.0 * benches[b].traffic * ops.dim;
+        std::fprintf(out, "%s\n    { \"op\": \"%s\", \"dim\": %u, \"threads\": %u, \"iterations\": %llu, "
+                     "\"nsPerOp\": %.3f, \"gbPerSec\": %.3f, \"allocsPerOp\": %.3f }",
+                     first ? "" : ",", benches[b].name, ops.dim, threads, res.iterations,
+                     res.nsPerOp, bytes / res.nsPerOp, res.allocsPerOp);
+        first = false;
+      }
+      std::fflush(out);
+
+      // Under threshold every thread count runs the same serial kernels
+      if (threads == cores || ops.dim < threshold)
+        break;
+    }
+  }
+  IVector::setParallelThreads(0);
+
+  std::fprintf(out, "\n  ]\n}\n");
+  if (out != stdout)
+    std::fclose(out);
+  return 0;
+}
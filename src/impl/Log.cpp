@@ -1,21 +1,829 @@
 #include "ILog.h"
+#include "logging.h"
+#include "log/logformat.h"
 
+#include <QByteArray>
 #include <QFile>
 #include <QTime>
 #include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 static QFile logFile;
 
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Appends "[hh:mm:ss.zzz] msg\n" to out
+  void appendLine(QByteArray& out, int msecs, const char* msg, size_t length)
+  {
+    out.append("[");
+    out.append(QTime::fromMSecsSinceStartOfDay(msecs).toString("hh:mm:ss.zzz").toUtf8());
+    out.append("] ");
+    out.append(msg, static_cast<int>(length));
+    out.append("\n");
+  }
+
+  /// \brief Nanoseconds of steady clock, time of queued messages
+  long long steadyNow()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  template <typename T>
+  void appendRaw(QByteArray& out, T value)
+  {
+    out.append(reinterpret_cast<const char*>(&value), static_cast<int>(sizeof(value)));
+  }
+
+  void appendRecordHead(QByteArray& out, size_t size, logformat::RecordKind kind)
+  {
+    appendRaw(out, static_cast<uint32_t>(size));
+    appendRaw(out, static_cast<uint8_t>(kind));
+  }
+
+  void appendTextRecord(QByteArray& out, long long time, const char* msg, size_t length)
+  {
+    appendRecordHead(out, 8 + length, logformat::RECORD_TEXT);
+    appendRaw(out, static_cast<int64_t>(time));
+    out.append(msg, static_cast<int>(length));
+  }
+
+  /// \brief Registered format of LOGF_* call site
+  struct Format
+  {
+    /// \brief "file:line [function] " as in LOCATION
+    std::string location;
+    std::string format;
+  };
+
+  /// \brief Formats by id - 1 in chunks which never move, kept for whole process life
+  ///
+  /// Registration appends under formatsMutex and publishes formatsCount
+  /// after entry is complete, readers of ids below it take no lock.
+  static const size_t  formatsChunk = 256;
+  static const size_t  maxFormatChunks = 1024;
+  std::mutex           formatsMutex;
+  std::atomic<Format*> formatChunks[maxFormatChunks];
+  std::atomic<size_t>  formatsCount(0);
+
+  /// \brief Format of index below formatsCount
+  const Format& formatAt(size_t index)
+  {
+    return formatChunks[index / formatsChunk].load(std::memory_order_relaxed)[index % formatsChunk];
+  }
+
+  /// \brief Appends format records of ids from + 1 .. to
+  void appendFormats(QByteArray& out, size_t from, size_t to)
+  {
+    for (size_t i = from; i < to; ++i) {
+      const Format& format = formatAt(i);
+      appendRecordHead(out, 4 + format.location.size() + 1 + format.format.size(),
+                       logformat::RECORD_FORMAT);
+      appendRaw(out, static_cast<uint32_t>(i + 1));
+      out.append(format.location.c_str(), static_cast<int>(format.location.size() + 1));
+      out.append(format.format.data(), static_cast<int>(format.format.size()));
+    }
+  }
+
+  /// \brief Message text kept in queue slot, longer ones go to heap
+  static const size_t inlineText = 232;
+
+  /// \brief Queued message
+  struct Entry
+  {
+    /// \brief Queue position this slot waits for, see Ring
+    std::atomic<size_t> sequence;
+    /// \brief Steady clock nanoseconds
+    long long    time;
+    /// \brief Format id of LOGF_* message, 0 for text
+    unsigned int format;
+    size_t       length;
+    char*        heap;
+    char         text[inlineText];
+
+    const char* data() const
+    {
+      return heap ? heap : text;
+    }
+  };
+
+  void appendRecord(QByteArray& out, const Entry& entry)
+  {
+    if (entry.format == 0) {
+      appendTextRecord(out, entry.time, entry.data(), entry.length);
+      return;
+    }
+    appendRecordHead(out, 4 + 8 + entry.length, logformat::RECORD_MESSAGE);
+    appendRaw(out, static_cast<uint32_t>(entry.format));
+    appendRaw(out, static_cast<int64_t>(entry.time));
+    out.append(entry.data(), static_cast<int>(entry.length));
+  }
+
+  /// \brief Serializes writes to logFile, its opening and closing
+  std::mutex syncMutex;
+
+  /// \brief Steady clock and time of day at opening of logFile
+  long long sessionTime = 0;
+  int       sessionMsecs = 0;
+
+  /// \brief Bounded multi-producer queue of messages
+  ///
+  /// Slot of position pos is free for producer when its sequence is pos
+  /// and full for consumer when it is pos + 1. Producers and consumers
+  /// claim positions by CAS, nobody waits for a lock. Consumers may be
+  /// several, so overflowing producers can drop oldest entries themselves.
+  class Ring {
+  public:
+    /// \brief Receives popped entry before its slot is reused
+    class Sink {
+    public:
+      virtual void take(const Entry& entry) = 0;
+
+    protected:
+      ~Sink() {  }
+    };
+
+    Ring()
+      : m_entries(NULL),
+        m_mask(0),
+        m_head(0),
+        m_tail(0)
+    {  }
+
+    ~Ring()
+    {
+      while (m_entries && tryPop(NULL))
+        ;
+      delete[] m_entries;
+    }
+
+    bool init(size_t capacity)
+    {
+      size_t size = 2;
+      while (size < capacity)
+        size <<= 1;
+
+      m_entries = new(std::nothrow) Entry[size];
+      if (!m_entries)
+        return false;
+      for (size_t i = 0; i < size; ++i)
+        m_entries[i].sequence.store(i, std::memory_order_relaxed);
+      m_mask = size - 1;
+      return true;
+    }
+
+    /// \returns false if queue is full
+    bool tryPush(long long time, unsigned int format, const char* msg, size_t length)
+    {
+      size_t pos = m_tail.load(std::memory_order_relaxed);
+      Entry* entry;
+      for (;;) {
+        entry = &m_entries[pos & m_mask];
+        const size_t sequence = entry->sequence.load(std::memory_order_acquire);
+        const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence - pos);
+        if (diff == 0) {
+          if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = m_tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      entry->time = time;
+      entry->format = format;
+      entry->length = length;
+      entry->heap = NULL;
+      char* text = entry->text;
+      if (length > inlineText) {
+        entry->heap = new(std::nothrow) char[length];
+        if (entry->heap)
+          text = entry->heap;
+        else
+          entry->length = length = inlineText;
+      }
+      std::memcpy(text, msg, length);
+
+      entry->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// \brief Takes oldest message, gives it to sink if it is not NULL
+    ///
+    /// \returns false if queue is empty
+    bool tryPop(Sink* sink)
+    {
+      size_t pos = m_head.load(std::memory_order_relaxed);
+      Entry* entry;
+      for (;;) {
+        entry = &m_entries[pos & m_mask];
+        const size_t sequence = entry->sequence.load(std::memory_order_acquire);
+        const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence - (pos + 1));
+        if (diff == 0) {
+          if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = m_head.load(std::memory_order_relaxed);
+        }
+      }
+
+      if (sink)
+        sink->take(*entry);
+      delete[] entry->heap;
+
+      entry->sequence.store(pos + m_mask + 1, std::memory_order_release);
+      return true;
+    }
+
+  private:
+    Entry*              m_entries;
+    size_t              m_mask;
+    /// \brief Consumer and producer positions on separate cache lines
+    char                m_padHead[64];
+    std::atomic<size_t> m_head;
+    char                m_padTail[64];
+    std::atomic<size_t> m_tail;
+  };
+
+  /// \brief Messages of one thread popped by writer and waiting for merge
+  class Staging : public Ring::Sink {
+  public:
+    explicit Staging(bool binary)
+      : m_binary(binary),
+        m_next(0),
+        m_begin(0)
+    {  }
+
+    void take(const Entry& entry)
+    {
+      if (m_binary)
+        appendRecord(m_bytes, entry);
+      else
+        appendLine(m_bytes, logformat::msecsOfDay(entry.time, sessionTime, sessionMsecs),
+                   entry.data(), entry.length);
+
+      Staged staged = { entry.time, m_bytes.size() };
+      m_staged.push_back(staged);
+    }
+
+    int size() const
+    {
+      return m_bytes.size() - m_begin;
+    }
+
+    bool hasNext() const
+    {
+      return m_next < m_staged.size();
+    }
+
+    long long nextTime() const
+    {
+      return m_staged[m_next].time;
+    }
+
+    /// \brief Appends next message to out
+    void takeNext(QByteArray& out)
+    {
+      const int end = m_staged[m_next++].end;
+      out.append(m_bytes.constData() + m_begin, end - m_begin);
+      m_begin = end;
+    }
+
+    /// \brief Forgets taken messages
+    void compact()
+    {
+      if (m_next == 0)
+        return;
+
+      if (m_next == m_staged.size()) {
+        m_bytes.clear();
+        m_staged.clear();
+      } else {
+        m_bytes.remove(0, m_begin);
+        m_staged.erase(m_staged.begin(), m_staged.begin() + m_next);
+        for (size_t i = 0; i < m_staged.size(); ++i)
+          m_staged[i].end -= m_begin;
+      }
+      m_next = 0;
+      m_begin = 0;
+    }
+
+  private:
+    struct Staged
+    {
+      long long time;
+      /// \brief End of message in m_bytes
+      int       end;
+    };
+
+    const bool          m_binary;
+    QByteArray          m_bytes;
+    std::vector<Staged> m_staged;
+    size_t              m_next;
+    int                 m_begin;
+  };
+
+  /// \brief busy of Buffer when its thread queues nothing
+  static const long long idle = std::numeric_limits<long long>::max();
+
+  /// \brief Queue of one writing thread
+  struct Buffer
+  {
+    explicit Buffer(bool binary)
+      : last(0),
+        busy(idle),
+        owned(true),
+        staging(binary)
+    {  }
+
+    Ring                   ring;
+    /// \brief Time of last message queued, used by owning thread only
+    long long              last;
+    /// \brief Bound message being queued has no earlier time than, idle if none
+    char                   padBusy[64];
+    std::atomic<long long> busy;
+    char                   padOwned[64];
+    /// \brief Some thread queues to buffer, guarded by AsyncLog::m_buffersMutex
+    bool                   owned;
+    /// \brief Used by writer only
+    Staging                staging;
+  };
+
+  /// \brief Buffer of calling thread in running log
+  struct ThreadBuffer
+  {
+    ThreadBuffer()
+      : log(0),
+        buffer(NULL)
+    {  }
+
+    /// \brief Gives buffer to next new thread
+    ~ThreadBuffer();
+
+    /// \brief Id of AsyncLog buffer belongs to
+    unsigned long long log;
+    Buffer*            buffer;
+  };
+
+  thread_local ThreadBuffer threadBuffer;
+
+  /// \brief Calling thread is writer of AsyncLog, see AsyncLog::push()
+  thread_local bool isWriter = false;
+
+  /// \brief Per-thread queues of messages and thread writing them to logFile
+  ///
+  /// Every thread queues to its own buffer, so threads never wait for
+  /// each other. Writer merges buffers in order of message time: before
+  /// queueing, thread publishes lower bound of its new message time,
+  /// and writer takes only messages not later than every bound and its
+  /// own clock, later ones wait for next round. Binary log writes
+  /// records, formats of LOGF_* call sites go to file before first
+  /// batch having their messages.
+  class AsyncLog {
+  public:
+    /// \returns running log or NULL
+    static AsyncLog* start(size_t capacity, ILog::OverflowPolicy policy, bool binary)
+    {
+      static unsigned long long lastId = 0;
+
+      AsyncLog* log = new(std::nothrow) AsyncLog(++lastId, capacity, policy, binary);
+      if (!log)
+        return NULL;
+
+      try {
+        log->m_thread = std::thread(&AsyncLog::loop, log);
+      } catch (const std::system_error&) {
+        delete log;
+        return NULL;
+      }
+      return log;
+    }
+
+    ~AsyncLog()
+    {
+      for (size_t i = 0; i < m_buffers.size(); ++i)
+        delete m_buffers[i];
+    }
+
+    int report(const char* msg)
+    {
+      return push(0, msg, std::strlen(msg));
+    }
+
+    int reportArgs(unsigned int format, const char* args, size_t length)
+    {
+      return push(format, args, length);
+    }
+
+    unsigned long long id() const
+    {
+      return m_id;
+    }
+
+    bool binary() const
+    {
+      return m_binary;
+    }
+
+    unsigned long long dropped() const
+    {
+      return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Lets another thread take buffer of exiting one
+    void release(Buffer* buffer)
+    {
+      std::lock_guard<std::mutex> lock(m_buffersMutex);
+      buffer->owned = false;
+    }
+
+    /// \brief Writes everything queued and joins writer
+    void stop()
+    {
+      m_stop.store(true, std::memory_order_release);
+      wake();
+      m_thread.join();
+    }
+
+  private:
+    AsyncLog(unsigned long long id, size_t capacity, ILog::OverflowPolicy policy, bool binary)
+      : m_id(id),
+        m_capacity(capacity),
+        m_policy(policy),
+        m_binary(binary),
+        m_buffersCount(0),
+        m_dropped(0),
+        m_droppedWritten(0),
+        m_formatsWritten(0),
+        m_stop(false),
+        m_sleeping(false)
+    {  }
+
+    /// \returns buffer of calling thread, NULL if there is no memory for it
+    Buffer* ownBuffer()
+    {
+      ThreadBuffer& own = threadBuffer;
+      if (own.log == m_id)
+        return own.buffer;
+
+      std::lock_guard<std::mutex> lock(m_buffersMutex);
+      Buffer* buffer = NULL;
+      for (size_t i = 0; i < m_buffers.size() && !buffer; ++i)
+        if (!m_buffers[i]->owned)
+          buffer = m_buffers[i];
+
+      if (buffer) {
+        buffer->owned = true;
+      } else {
+        buffer = new(std::nothrow) Buffer(m_binary);
+        if (!buffer || !buffer->ring.init(m_capacity)) {
+          delete buffer;
+          return NULL;
+        }
+        try {
+          m_buffers.push_back(buffer);
+        } catch (const std::bad_alloc&) {
+          delete buffer;
+          return NULL;
+        }
+        m_buffersCount.store(m_buffers.size(), std::memory_order_release);
+      }
+
+      own.log = m_id;
+      own.buffer = buffer;
+      return buffer;
+    }
+
+    int push(unsigned int format, const char* msg, size_t length)
+    {
+      Buffer* buffer = ownBuffer();
+      if (!buffer) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return ERR_MEMORY_ALLOCATION;
+      }
+
+      // Bound is published before clock is read, see loop()
+      buffer->busy.store(buffer->last, std::memory_order_seq_cst);
+      const long long time = steadyNow();
+      buffer->last = time;
+
+      int result = ERR_OK;
+      while (!buffer->ring.tryPush(time, format, msg, length)) {
+        if (m_policy == ILog::OVERFLOW_DROP_OLDEST) {
+          if (buffer->ring.tryPop(NULL))
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        } else if (m_policy == ILog::OVERFLOW_COUNT_DROPS) {
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+          result = ERR_OVERFULL;
+          break;
+        } else if (isWriter) {
+          // Writer reporting suppressed messages frees its queue itself
+          buffer->ring.tryPop(&buffer->staging);
+        } else {
+          wake();
+          std::this_thread::yield();
+        }
+      }
+      buffer->busy.store(idle, std::memory_order_release);
+
+      // Only first message after writer fell asleep pays for wakeup
+      if (m_sleeping.load(std::memory_order_relaxed) &&
+          m_sleeping.exchange(false, std::memory_order_relaxed))
+        wake();
+      return result;
+    }
+
+    void wake()
+    {
+      m_wake.notify_one();
+    }
+
+    /// \brief Appends messages of buffers not later than limit in time order
+    void merge(const std::vector<Buffer*>& buffers, long long limit, QByteArray& out)
+    {
+      while (out.size() < maxBatch) {
+        Staging* next = NULL;
+        for (size_t i = 0; i < buffers.size(); ++i) {
+          Staging& staging = buffers[i]->staging;
+          if (staging.hasNext() && staging.nextTime() <= limit &&
+              (!next || staging.nextTime() < next->nextTime()))
+            next = &staging;
+        }
+        if (!next)
+          return;
+        next->takeNext(out);
+      }
+    }
+
+    void loop()
+    {
+      isWriter = true;
+
+      std::vector<Buffer*> buffers;
+      QByteArray batch;
+      QByteArray head;
+      long long nextSummary = steadyNow() + summaryPeriod;
+      for (;;) {
+        // Stop is read before queues, so messages queued before stop() are written
+        const bool stopping = m_stop.load(std::memory_order_acquire);
+
+        // Call sites over rate limit are summarized even if they report nothing more
+        const long long now = steadyNow();
+        if (now >= nextSummary) {
+          ILog::reportSuppressed();
+          nextSummary = now + summaryPeriod;
+        }
+
+        if (m_buffersCount.load(std::memory_order_acquire) != buffers.size()) {
+          std::lock_guard<std::mutex> lock(m_buffersMutex);
+          buffers = m_buffers;
+        }
+
+        // Thread found idle queues later than clock read here, busy one no
+        // earlier than its bound, so nothing earlier than limit comes later
+        long long limit = steadyNow();
+        for (size_t i = 0; i < buffers.size(); ++i)
+          limit = std::min(limit, buffers[i]->busy.load(std::memory_order_seq_cst));
+
+        for (size_t i = 0; i < buffers.size(); ++i) {
+          Buffer* buffer = buffers[i];
+          while (buffer->staging.size() < maxBatch && buffer->ring.tryPop(&buffer->staging))
+            ;
+        }
+
+        batch.clear();
+        merge(buffers, limit, batch);
+        for (size_t i = 0; i < buffers.size(); ++i)
+          buffers[i]->staging.compact();
+
+        const unsigned long long dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_droppedWritten) {
+          const std::string note = std::to_string(dropped - m_droppedWritten) + " log messages dropped";
+          if (m_binary)
+            appendTextRecord(batch, steadyNow(), note.c_str(), note.size());
+          else
+            appendLine(batch, QTime::currentTime().msecsSinceStartOfDay(), note.c_str(), note.size());
+          m_droppedWritten = dropped;
+        }
+
+        // Formats are read after messages, so every popped id is registered
+        head.clear();
+        if (m_binary) {
+          const size_t count = formatsCount.load(std::memory_order_acquire);
+          if (count != m_formatsWritten) {
+            appendFormats(head, m_formatsWritten, count);
+            m_formatsWritten = count;
+          }
+        }
+
+        if (head.size() > 0 || batch.size() > 0) {
+          // Threads come to synchronous path once log is taken by ILog::destroy()
+          std::lock_guard<std::mutex> lock(syncMutex);
+          if (head.size() > 0)
+            logFile.write(head);
+          logFile.write(batch);
+          logFile.flush();
+          continue;
+        }
+        if (stopping)
+          return;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.store(true, std::memory_order_relaxed);
+        m_wake.wait_for(lock, idleWait);
+        m_sleeping.store(false, std::memory_order_relaxed);
+      }
+    }
+
+    /// \brief Bytes written by one QFile::write() or staged per thread at most, roughly
+    static const int maxBatch = 64 * 1024;
+
+    /// \brief Writer sleeps this long when queues are empty, wakeups may be missed
+    static const std::chrono::milliseconds idleWait;
+
+    /// \brief Steady clock nanoseconds between ILog::reportSuppressed() calls of writer
+    static const long long summaryPeriod = LOG_RATE_PERIOD_MS * 1000000LL;
+
+    const unsigned long long           m_id;
+    const size_t                       m_capacity;
+    const ILog::OverflowPolicy         m_policy;
+    const bool                         m_binary;
+    /// \brief Buffers are reused, not freed, until log stops
+    std::mutex                         m_buffersMutex;
+    std::vector<Buffer*>               m_buffers;
+    std::atomic<size_t>                m_buffersCount;
+    std::atomic<unsigned long long>    m_dropped;
+    unsigned long long                 m_droppedWritten;
+    size_t                             m_formatsWritten;
+    std::atomic<bool>                  m_stop;
+    std::atomic<bool>                  m_sleeping;
+    std::mutex                         m_mutex;
+    std::condition_variable            m_wake;
+    std::thread                        m_thread;
+  };
+
+  const std::chrono::milliseconds AsyncLog::idleWait(10);
+
+  /// \brief Running asynchronous log, NULL in synchronous mode
+  std::atomic<AsyncLog*> asyncLog(NULL);
+
+  /// \brief Threads between reading asyncLog and finishing with it
+  std::atomic<unsigned int> asyncCallers(0);
+
+  /// \brief Guards asyncLog against exiting threads, see ~ThreadBuffer()
+  std::mutex asyncLogMutex;
+
+  /// \brief asyncLog which ILog::destroy() does not delete while it is used
+  ///
+  /// Caller is counted before asyncLog is read and destroy() waits for
+  /// callers after taking it, both sequentially consistent, so either
+  /// caller sees NULL or destroy() sees caller.
+  class ActiveLog {
+  public:
+    ActiveLog()
+    {
+      asyncCallers.fetch_add(1, std::memory_order_seq_cst);
+      m_log = asyncLog.load(std::memory_order_seq_cst);
+    }
+
+    ~ActiveLog()
+    {
+      asyncCallers.fetch_sub(1, std::memory_order_release);
+    }
+
+    AsyncLog* operator->() const { return m_log; }
+    operator bool() const { return m_log != NULL; }
+
+  private:
+    AsyncLog* m_log;
+
+    /*non default copyable*/
+    ActiveLog(const ActiveLog& other) = delete;
+    void operator=(const ActiveLog& other) = delete;
+  };
+
+  /// \brief Takes asyncLog away and waits until nobody uses it
+  AsyncLog* takeAsyncLog()
+  {
+    AsyncLog* log;
+    {
+      std::lock_guard<std::mutex> lock(asyncLogMutex);
+      log = asyncLog.exchange(NULL, std::memory_order_seq_cst);
+    }
+
+    // Blocked producers are freed by writer, which runs until stop()
+    while (log && asyncCallers.load(std::memory_order_seq_cst) != 0)
+      std::this_thread::yield();
+    return log;
+  }
+
+  ThreadBuffer::~ThreadBuffer()
+  {
+    std::lock_guard<std::mutex> lock(asyncLogMutex);
+    AsyncLog* running = asyncLog.load(std::memory_order_relaxed);
+    if (buffer && running && running->id() == log)
+      running->release(buffer);
+  }
+
+  /// \brief Dropped messages of last asynchronous log
+  unsigned long long droppedTotal = 0;
+
+  /// \brief logFile is binary, see ILog::initBinary()
+  bool binaryLog = false;
+
+  /// \brief Opens logFile, binary one starts with session record
+  int openLog(const char* fileName, bool binary)
+  {
+    if(!fileName)
+      return ERR_WRONG_ARG;
+
+    std::lock_guard<std::mutex> lock(syncMutex);
+    if(logFile.isOpen())
+      return ERR_OPEN_ILogImpl;
+
+    logFile.setFileName(QString(fileName));
+
+    if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      qWarning() << "Cannot open logFile: " << logFile.errorString();
+      return ERR_OPEN_ILogImpl;
+    }
+
+    sessionTime = steadyNow();
+    sessionMsecs = QTime::currentTime().msecsSinceStartOfDay();
+    droppedTotal = 0;
+
+    if (binary) {
+      // Session start lets LogDecode turn steady clock into time of day
+      QByteArray session;
+      session.append(logformat::magic, static_cast<int>(sizeof(logformat::magic)));
+      appendRaw(session, static_cast<int64_t>(sessionTime));
+      appendRaw(session, static_cast<int32_t>(sessionMsecs));
+      logFile.write(session);
+      binaryLog = true;
+    }
+    return ERR_OK;
+  }
+
+  int startAsync(unsigned int capacity, ILog::OverflowPolicy policy, bool binary)
+  {
+    AsyncLog* log = AsyncLog::start(capacity, policy, binary);
+    if (!log) {
+      qWarning() << "Cannot start log writer thread";
+      ILog::destroy();
+      return ERR_MEMORY_ALLOCATION;
+    }
+
+    std::lock_guard<std::mutex> lock(asyncLogMutex);
+    asyncLog.store(log, std::memory_order_seq_cst);
+    return ERR_OK;
+  }
+
+  /// \brief Lowest level reported by LOG_* macros
+  std::atomic<int> minLevel(ILog::LEVEL_TRACE);
+
+  /// \brief Call sites which suppressed messages, linked by m_nextWatched
+  std::atomic<LogSite*> watchedSites(NULL);
+}
+
 int ILog::report(const char *msg)
 {
   if (!msg)
     return ERR_WRITE_TO_ILogImpl;
 
+  {
+    ActiveLog log;
+    if (log)
+      return log->report(msg);
+  }
+
+  std::lock_guard<std::mutex> lock(syncMutex);
   if(!logFile.isOpen() || !logFile.isWritable()) {
     qWarning() << "logFile is not open: " << logFile.errorString();
     return ERR_WRITE_TO_ILogImpl;
   }
 
+  if (binaryLog) {
+    QByteArray record;
+    appendTextRecord(record, steadyNow(), msg, std::strlen(msg));
+    logFile.write(record);
+    logFile.flush();
+    return ERR_OK;
+  }
+
   const QString timeString =
     "[" + QTime::currentTime().toString("hh:mm:ss.zzz") + "] ";
 
@@ -30,24 +838,155 @@ int ILog::report(const char *msg)
 
 int ILog::init(const char* fileName)
 {
-  if(!fileName)
+  int result = openLog(fileName, false);
+  if (result != ERR_OK)
+    return result;
+
+  return report("log begin");
+}
+
+int ILog::initAsync(const char* fileName, unsigned int capacity, OverflowPolicy policy)
+{
+  if (capacity == 0 || policy < OVERFLOW_BLOCK || policy >= DIMENSION_OVERFLOW_POLICY)
     return ERR_WRONG_ARG;
 
-  if(logFile.isOpen())
-    return ERR_OPEN_ILogImpl;
+  int result = init(fileName);
+  if (result != ERR_OK)
+    return result;
+
+  return startAsync(capacity, policy, false);
+}
 
-  logFile.setFileName(QString(fileName));
+int ILog::initBinary(const char* fileName, unsigned int capacity, OverflowPolicy policy)
+{
+  if (capacity == 0 || policy < OVERFLOW_BLOCK || policy >= DIMENSION_OVERFLOW_POLICY)
+    return ERR_WRONG_ARG;
 
-  if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-    qWarning() << "Cannot open logFile: " << logFile.errorString();
-    return ERR_OPEN_ILogImpl;
+  int result = openLog(fileName, true);
+  if (result != ERR_OK)
+    return result;
+
+  result = report("log begin");
+  if (result != ERR_OK) {
+    destroy();
+    return result;
   }
+  return startAsync(capacity, policy, true);
+}
 
-  return report("log begin");
+unsigned int ILog::registerFormat(const char* location, const char* function, const char* format)
+{
+  if (!location || !function || !format)
+    return 0;
+
+  try {
+    Format entry;
+    entry.location = std::string(location) + " [" + function + "] ";
+    entry.format = format;
+
+    std::lock_guard<std::mutex> lock(formatsMutex);
+    const size_t index = formatsCount.load(std::memory_order_relaxed);
+    if (index % formatsChunk == 0) {
+      if (index / formatsChunk >= maxFormatChunks)
+        return 0;
+      formatChunks[index / formatsChunk].store(new Format[formatsChunk], std::memory_order_relaxed);
+    }
+
+    Format& slot = formatChunks[index / formatsChunk].load(std::memory_order_relaxed)[index % formatsChunk];
+    slot.location.swap(entry.location);
+    slot.format.swap(entry.format);
+    formatsCount.store(index + 1, std::memory_order_release);
+    return static_cast<unsigned int>(index + 1);
+  } catch (const std::bad_alloc&) {
+    return 0;
+  }
+}
+
+int ILog::reportArgs(unsigned int formatId, const char* args, unsigned int length)
+{
+  if (formatId == 0 || (!args && length > 0))
+    return ERR_WRONG_ARG;
+
+  {
+    ActiveLog log;
+    if (log && log->binary())
+      return log->reportArgs(formatId, args, length);
+  }
+
+  if (formatId > formatsCount.load(std::memory_order_acquire))
+    return ERR_WRONG_ARG;
+
+  const Format& format = formatAt(formatId - 1);
+  std::string line = format.location;
+  logformat::appendMessage(line, format.format.c_str(), args, length);
+  return report(line.c_str());
+}
+
+unsigned long long ILog::getDropped()
+{
+  {
+    ActiveLog log;
+    if (log)
+      return log->dropped();
+  }
+
+  std::lock_guard<std::mutex> lock(syncMutex);
+  return droppedTotal;
+}
+
+int ILog::setLevel(Level level)
+{
+  if (level < LEVEL_TRACE || level >= DIMENSION_LEVEL)
+    return ERR_WRONG_ARG;
+
+  minLevel.store(level, std::memory_order_relaxed);
+  return ERR_OK;
+}
+
+ILog::Level ILog::getLevel()
+{
+  return static_cast<Level>(minLevel.load(std::memory_order_relaxed));
+}
+
+bool ILog::isEnabled(Level level)
+{
+  return level >= minLevel.load(std::memory_order_relaxed);
+}
+
+void ILog::watch(LogSite* site)
+{
+  if (!site)
+    return;
+
+  LogSite* head = watchedSites.load(std::memory_order_relaxed);
+  do {
+    site->m_nextWatched = head;
+  } while (!watchedSites.compare_exchange_weak(head, site, std::memory_order_release,
+                                               std::memory_order_relaxed));
+}
+
+void ILog::reportSuppressed()
+{
+  for (LogSite* site = watchedSites.load(std::memory_order_acquire); site; site = site->m_nextWatched)
+    site->reportSuppressed();
 }
 
 void ILog::destroy()
 {
+  reportSuppressed();
+
+  AsyncLog* log = takeAsyncLog();
+  if (log) {
+    log->stop();
+    {
+      std::lock_guard<std::mutex> lock(syncMutex);
+      droppedTotal = log->dropped();
+    }
+    delete log;
+  }
+
   report("log end\n");
+  std::lock_guard<std::mutex> lock(syncMutex);
   logFile.close();
+  binaryLog = false;
 }
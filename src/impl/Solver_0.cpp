@@ -22,6 +22,7 @@
   #include "ISolver.h"
   #include "IProblem.h"
   #include "ICompact.h"
+  #include "IVectorArena.h"
   #include "logging.h"
 #pragma warning(pop)
 
@@ -212,7 +213,7 @@ int Solver_0::setParams(QString& str)
   }
 
   QScopedPointer<IVector> solverParams(
-        IVector::createVector(static_cast<unsigned int>(params.size()), paramsAsArray.data()));
+        IVector::createView(static_cast<unsigned int>(params.size()), paramsAsArray.data()));
   if (!solverParams)
     LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
 
@@ -222,14 +223,15 @@ int Solver_0::setParams(QString& str)
 int Solver_0::doStep(double alpha, double lam, IVector* grad, bool byArgs)
 {
   while (true) {
-    QScopedPointer<IVector> tmpMS(
-          IVector::multiplyByScalar(grad, alpha));
-    if (!tmpMS)
-      LOG_RET("Can't multiply by scalar", ERR_ANY_OTHER);
+    // Temporaries of this attempt are freed at once on scope exit
+    IVectorArena::Scope scope;
 
-    QScopedPointer<IVector> tmpS(
-          IVector::subtract(m_curr.data(), tmpMS.data()));
+    // tmpS = curr - alpha * grad in a single pass
+    QScopedPointer<IVector> tmpS(scope.arena()->clone(m_curr.data()));
     if (!tmpS)
+      LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+
+    if (tmpS->axpy(-alpha, grad) != ERR_OK)
       LOG_RET("Can't subtract", ERR_ANY_OTHER);
 
     IVector* prS_data;
@@ -271,24 +273,28 @@ int Solver_0::getGrad(IVector*& res, bool byArgs)
   if (m_problem->getArgsDim(argsDim) != ERR_OK)
     LOG_RET("Can't get argsDim", ERR_ANY_OTHER);
 
-  QVector<double> gradArray(static_cast<int>(argsDim));
+  // Gradient lives in thread arena, caller holds IVectorArena::Scope
+  IVector* gradVec = IVectorArena::getThreadArena()->createVector(argsDim, NULL);
+  if (!gradVec)
+    LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+
   for (size_t i = 0; i < argsDim; i++) {
+    double value;
     if (byArgs) {
       if (m_problem->derivativeGoalFunctionByArgs(1, i, IProblem::BY_ARGS,
-          gradArray[static_cast<int>(i)], m_curr.data()) != ERR_OK)
+          value, m_curr.data()) != ERR_OK)
         LOG_RET("Can't get derivative of goal function by arguments", ERR_ANY_OTHER);
 
     } else {
       if (m_problem->derivativeGoalFunctionByParams(1, i, IProblem::BY_PARAMS,
-          gradArray[static_cast<int>(i)], m_curr.data()) != ERR_OK)
+          value, m_curr.data()) != ERR_OK)
         LOG_RET("Can't get goal function derivative by parameters", ERR_ANY_OTHER);
 
     }
-  }
 
-  IVector* gradVec = IVector::createVector(argsDim, gradArray.data());
-  if (!gradVec)
-    LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+    if (gradVec->setCoord(i, value) != ERR_OK)
+      LOG_RET("Can't set gradient coordinate", ERR_ANY_OTHER);
+  }
 
   res = gradVec;
   return ERR_OK;
@@ -304,6 +310,8 @@ int Solver_0::doSolveByArgs()
     LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
 
   while (true) {
+    IVectorArena::Scope scope;
+
     IVector* gradVec;
     int res;
     if ((res = getGrad(gradVec, true)) != ERR_OK) {
@@ -338,6 +346,8 @@ int Solver_0::doSolveByParams()
     LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
 
   while (true) {
+    IVectorArena::Scope scope;
+
     IVector* gradVec;
     int res;
     if ((res = getGrad(gradVec, false)) != ERR_OK) {
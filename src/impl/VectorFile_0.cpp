@@ -0,0 +1,696 @@
+#include <QFile>
+#include <QSysInfo>
+#include <QVector>
+#include <QtEndian>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include "IVectorFile.h"
+#include "error.h"
+#include "logging.h"
+
+const double EPS = 1e-8;
+
+namespace {
+/// \brief Layout constants of format version 1
+const char magic[8] = { 'I', 'V', 'E', 'C', 'B', 'I', 'N', '\0' };
+const quint32 formatVersion = 1;
+const quint32 headerSize = 64;
+const quint32 payloadAlignment = 64;
+
+/// \brief Header fields in host byte order
+struct Header
+{
+    quint32 precision;
+    quint32 dim;
+    quint32 alignment;
+    quint64 count;
+    quint64 offset;
+    quint64 stride;
+};
+
+size_t coordSize(quint32 precision)
+{
+    return precision == IVector::PRECISION_FLOAT ? sizeof(float) : sizeof(double);
+}
+
+void encodeHeader(Header const& header, uchar* raw)
+{
+    memset(raw, 0, headerSize);
+    memcpy(raw, magic, sizeof(magic));
+    qToLittleEndian<quint32>(formatVersion, raw + 8);
+    qToLittleEndian<quint32>(header.precision, raw + 12);
+    qToLittleEndian<quint32>(header.dim, raw + 16);
+    qToLittleEndian<quint32>(header.alignment, raw + 20);
+    qToLittleEndian<quint64>(header.count, raw + 24);
+    qToLittleEndian<quint64>(header.offset, raw + 32);
+    qToLittleEndian<quint64>(header.stride, raw + 40);
+}
+
+/// \brief Reads and validates header against file size
+int decodeHeader(uchar const* raw, quint64 fileSize, Header& header)
+{
+    if (memcmp(raw, magic, sizeof(magic)) != 0)
+    {
+        LOG("ERR: Not a vector file");
+        return ERR_WRONG_ARG;
+    }
+    if (qFromLittleEndian<quint32>(raw + 8) != formatVersion)
+    {
+        LOG("ERR: Unsupported vector file version");
+        return ERR_NOT_IMPLEMENTED;
+    }
+
+    header.precision = qFromLittleEndian<quint32>(raw + 12);
+    header.dim = qFromLittleEndian<quint32>(raw + 16);
+    header.alignment = qFromLittleEndian<quint32>(raw + 20);
+    header.count = qFromLittleEndian<quint64>(raw + 24);
+    header.offset = qFromLittleEndian<quint64>(raw + 32);
+    header.stride = qFromLittleEndian<quint64>(raw + 40);
+
+    if (header.precision >= IVector::DIMENSION_PRECISION || header.dim == 0 ||
+        header.alignment == 0 || header.offset < headerSize ||
+        header.offset % header.alignment != 0 || header.offset % coordSize(header.precision) != 0 ||
+        header.stride < header.dim * coordSize(header.precision) ||
+        header.stride % coordSize(header.precision) != 0 ||
+        header.count > 0xFFFFFFFFULL)
+    {
+        LOG("ERR: Corrupted vector file header");
+        return ERR_WRONG_ARG;
+    }
+    if (header.offset > fileSize || (fileSize - header.offset) / header.stride < header.count)
+    {
+        LOG("ERR: Vector file is truncated");
+        return ERR_OUT_OF_RANGE;
+    }
+    return ERR_OK;
+}
+
+/// \brief Read-only mapping of vector file
+///
+/// Shared by IVectorFile and sets created from it,
+/// unmapped when the last of them is deleted.
+class Mapping
+{
+public:
+    static Mapping* open(char const* path, int& errType);
+
+    void retain() { m_refs.fetch_add(1); }
+    void release()
+    {
+        if (m_refs.fetch_sub(1) == 1)
+            delete this;
+    }
+
+    Header const& header() const { return m_header; }
+
+    uchar* vector(unsigned int index) const
+    {
+        return m_data + m_header.offset + static_cast<quint64>(index) * m_header.stride;
+    }
+
+    /// \brief Coordinates of vector as doubles
+    void read(unsigned int index, double* dst) const
+    {
+        if (m_header.precision == IVector::PRECISION_FLOAT)
+        {
+            float const* src = reinterpret_cast<float const*>(vector(index));
+            for (unsigned int i = 0; i < m_header.dim; i++)
+                dst[i] = src[i];
+        }
+        else
+            memcpy(dst, vector(index), m_header.dim * sizeof(double));
+    }
+
+    /// \brief Copy of vector, kept with precision of file
+    IVector* copy(unsigned int index) const
+    {
+        if (m_header.precision == IVector::PRECISION_DOUBLE)
+            return IVector::createVector(m_header.dim, reinterpret_cast<double const*>(vector(index)));
+
+        QVector<double> coords(static_cast<int>(m_header.dim));
+        read(index, coords.data());
+        return IVector::createVector(m_header.dim, coords.data(), IVector::PRECISION_FLOAT);
+    }
+
+private:
+    Mapping(char const* path)
+      : m_file(path), m_data(nullptr), m_refs(1)
+    {
+    }
+
+    ~Mapping()
+    {
+        if (m_data)
+            m_file.unmap(m_data);
+        m_file.close();
+    }
+
+    QFile m_file;
+    uchar* m_data;
+    Header m_header;
+    std::atomic<int> m_refs;
+};
+
+class VectorFile_0 : public IVectorFile
+{
+public:
+    int getId() const;
+
+    unsigned int getDim() const;
+    unsigned int getCount() const;
+    IVector::Precision getPrecision() const;
+    IVector* getVector(unsigned int index) const;
+    ISet* createSet() const;
+
+    /*ctor*/
+    VectorFile_0(Mapping* mapping);
+    /*dtor*/
+    ~VectorFile_0();
+
+private:
+    Mapping* m_mapping;
+};
+
+/// \brief Read-only ISet over mapped vector file
+///
+/// get() copies one vector out of mapping, nothing else is copied.
+class Set_M : public ISet
+{
+public:
+    int getId() const;
+    int put(IVector const* const element);
+    int get(unsigned int index, IVector*& p_element) const;
+    int remove(unsigned int index);
+    int contains(IVector const* const p_element, bool& result) const;
+    unsigned int getSize() const;
+    int clear();
+
+    IIterator* begin();
+    IIterator* end();
+
+    int deleteIterator(IIterator * pIter);
+    int getByIterator(IIterator const* pIter, IVector*& p_element) const;
+
+    class Iterator_M : public ISet::IIterator
+    {
+    public:
+        int next();
+        int prev();
+        bool isEnd() const;
+        bool isBegin() const;
+
+        ISet const* const m_set;
+        unsigned int m_pos;
+
+        Iterator_M(ISet const* const set, unsigned int pos);
+    };
+
+    /*ctor*/
+    Set_M(Mapping* mapping);
+    /*dtor*/
+    ~Set_M();
+
+private:
+    int findIterator(IIterator const * pIter) const;
+    IIterator* createIterator(unsigned int pos);
+    Mapping* m_mapping;
+    QVector<Iterator_M*> m_ptr_iterators;
+};
+
+/// \brief Coordinates of vector, through its storage if it has one
+int coordsOf(IVector const* const vector, QVector<double>& buffer, double const*& coords)
+{
+    unsigned int dim;
+    if (vector->getCoordsPtr(dim, coords) == ERR_OK)
+        return ERR_OK;
+
+    buffer.resize(static_cast<int>(vector->getDim()));
+    for (unsigned int i = 0; i < vector->getDim(); i++)
+    {
+        int errType = vector->getCoord(i, buffer[static_cast<int>(i)]);
+        if (errType != ERR_OK)
+        {
+            LOG("ERR: Failed to get coordinate");
+            return errType;
+        }
+    }
+    coords = buffer.data();
+    return ERR_OK;
+}
+} //end anonymous namespace
+
+/* ---- Writers ---- */
+
+int IVectorFile::save(char const* path, unsigned int count, IVector const* const* vectors,
+                      IVector::Precision precision)
+{
+    if (!path || !vectors || count == 0)
+    {
+        LOG("ERR: Incorrect argument");
+        return ERR_WRONG_ARG;
+    }
+    if (precision != IVector::PRECISION_DOUBLE && precision != IVector::PRECISION_FLOAT)
+    {
+        LOG("ERR: Unknown precision");
+        return ERR_WRONG_ARG;
+    }
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+    {
+        LOG("ERR: Vector files are supported on little-endian hosts only");
+        return ERR_NOT_IMPLEMENTED;
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!vectors[i])
+        {
+            LOG("ERR: Incorrect argument");
+            return ERR_WRONG_ARG;
+        }
+        if (vectors[i]->getDim() != vectors[0]->getDim() || vectors[i]->getDim() == 0)
+        {
+            LOG("ERR: Dimensions mismatch");
+            return ERR_DIMENSIONS_MISMATCH;
+        }
+    }
+
+    Header header;
+    header.precision = precision;
+    header.dim = vectors[0]->getDim();
+    header.alignment = payloadAlignment;
+    header.count = count;
+    header.offset = headerSize;
+    header.stride = header.dim * coordSize(precision);
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LOG("ERR: Failed to open vector file for writing");
+        return ERR_ANY_OTHER;
+    }
+
+    uchar raw[headerSize];
+    encodeHeader(header, raw);
+    if (file.write(reinterpret_cast<char const*>(raw), headerSize) != headerSize)
+    {
+        LOG("ERR: Failed to write vector file");
+        return ERR_ANY_OTHER;
+    }
+
+    QVector<double> buffer;
+    QVector<float> narrowed(static_cast<int>(precision == IVector::PRECISION_FLOAT ? header.dim : 0));
+    for (unsigned int i = 0; i < count; i++)
+    {
+        double const* coords;
+        int errType = coordsOf(vectors[i], buffer, coords);
+        if (errType != ERR_OK)
+            return errType;
+
+        char const* payload = reinterpret_cast<char const*>(coords);
+        if (precision == IVector::PRECISION_FLOAT)
+        {
+            for (unsigned int j = 0; j < header.dim; j++)
+                narrowed[static_cast<int>(j)] = static_cast<float>(coords[j]);
+            payload = reinterpret_cast<char const*>(narrowed.data());
+        }
+
+        if (file.write(payload, static_cast<qint64>(header.stride)) != static_cast<qint64>(header.stride))
+        {
+            LOG("ERR: Failed to write vector file");
+            return ERR_ANY_OTHER;
+        }
+    }
+
+    file.close();
+    return ERR_OK;
+}
+
+int IVectorFile::save(char const* path, ISet const* const set, IVector::Precision precision)
+{
+    if (!set)
+    {
+        LOG("ERR: Incorrect argument");
+        return ERR_WRONG_ARG;
+    }
+
+    QVector<IVector*> vectors;
+    int errType = ERR_OK;
+    for (unsigned int i = 0; i < set->getSize() && errType == ERR_OK; i++)
+    {
+        IVector* vector = nullptr;
+        errType = set->get(i, vector);
+        if (errType == ERR_OK)
+            vectors.append(vector);
+    }
+
+    if (errType == ERR_OK)
+        errType = save(path, static_cast<unsigned int>(vectors.size()), vectors.data(), precision);
+
+    for (int i = 0; i < vectors.size(); i++)
+        delete vectors[i];
+    if (errType != ERR_OK)
+        LOG("ERR: Failed to save set");
+    return errType;
+}
+
+/* ---- Loader ---- */
+
+Mapping* Mapping::open(char const* path, int& errType)
+{
+    Mapping* mapping = new(std::nothrow) Mapping(path);
+    if (!mapping)
+    {
+        LOG("ERR: Not enough memory");
+        errType = ERR_MEMORY_ALLOCATION;
+        return nullptr;
+    }
+
+    if (!mapping->m_file.open(QIODevice::ReadOnly))
+    {
+        LOG("ERR: Failed to open vector file");
+        errType = ERR_WRONG_ARG;
+        mapping->release();
+        return nullptr;
+    }
+
+    const qint64 size = mapping->m_file.size();
+    if (size < static_cast<qint64>(headerSize))
+    {
+        LOG("ERR: Vector file is truncated");
+        errType = ERR_OUT_OF_RANGE;
+        mapping->release();
+        return nullptr;
+    }
+
+    // Private mapping lets views be written without touching the file
+    mapping->m_data = mapping->m_file.map(0, size, QFileDevice::MapPrivateOption);
+    if (!mapping->m_data)
+    {
+        LOG("ERR: Failed to map vector file");
+        errType = ERR_ANY_OTHER;
+        mapping->release();
+        return nullptr;
+    }
+
+    errType = decodeHeader(mapping->m_data, static_cast<quint64>(size), mapping->m_header);
+    if (errType != ERR_OK)
+    {
+        mapping->release();
+        return nullptr;
+    }
+    return mapping;
+}
+
+IVectorFile* IVectorFile::open(char const* path)
+{
+    if (!path)
+    {
+        LOG("ERR: Incorrect argument");
+        return nullptr;
+    }
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+    {
+        LOG("ERR: Vector files are supported on little-endian hosts only");
+        return nullptr;
+    }
+
+    int errType;
+    Mapping* mapping = Mapping::open(path, errType);
+    if (!mapping)
+        return nullptr;
+
+    IVectorFile* file = new(std::nothrow) VectorFile_0(mapping);
+    if (!file)
+    {
+        LOG("ERR: Not enough memory");
+        mapping->release();
+        return nullptr;
+    }
+    return file;
+}
+
+VectorFile_0::VectorFile_0(Mapping* mapping)
+  : m_mapping(mapping)
+{
+}
+
+VectorFile_0::~VectorFile_0()
+{
+    m_mapping->release();
+}
+
+int VectorFile_0::getId() const
+{
+    return IVectorFile::INTERFACE_0;
+}
+
+unsigned int VectorFile_0::getDim() const
+{
+    return m_mapping->header().dim;
+}
+
+unsigned int VectorFile_0::getCount() const
+{
+    return static_cast<unsigned int>(m_mapping->header().count);
+}
+
+IVector::Precision VectorFile_0::getPrecision() const
+{
+    return static_cast<IVector::Precision>(m_mapping->header().precision);
+}
+
+IVector* VectorFile_0::getVector(unsigned int index) const
+{
+    if (index >= getCount())
+    {
+        LOG("ERR: Out of range");
+        return nullptr;
+    }
+
+    if (getPrecision() != IVector::PRECISION_DOUBLE)
+        return m_mapping->copy(index);
+    return IVector::createView(getDim(), reinterpret_cast<double*>(m_mapping->vector(index)));
+}
+
+ISet* VectorFile_0::createSet() const
+{
+    ISet* set = new(std::nothrow) Set_M(m_mapping);
+    if (!set)
+    {
+        LOG("ERR: Not enough memory");
+        return nullptr;
+    }
+    return set;
+}
+
+/* ---- Set_M implementation ---- */
+
+Set_M::Set_M(Mapping* mapping)
+  : m_mapping(mapping)
+{
+    m_mapping->retain();
+}
+
+Set_M::~Set_M()
+{
+    for (int i = 0; i < m_ptr_iterators.size(); i++)
+    {
+        delete m_ptr_iterators[i];
+    }
+    m_mapping->release();
+}
+
+int Set_M::getId() const
+{
+    return ISet::INTERFACE_0;
+}
+
+unsigned int Set_M::getSize() const
+{
+    return static_cast<unsigned int>(m_mapping->header().count);
+}
+
+int Set_M::put(IVector const* const)
+{
+    LOG("ERR: Set of vector file is read-only");
+    return ERR_NOT_IMPLEMENTED;
+}
+
+int Set_M::remove(unsigned int)
+{
+    LOG("ERR: Set of vector file is read-only");
+    return ERR_NOT_IMPLEMENTED;
+}
+
+int Set_M::clear()
+{
+    LOG("ERR: Set of vector file is read-only");
+    return ERR_NOT_IMPLEMENTED;
+}
+
+int Set_M::get(unsigned int index, IVector*& p_element) const
+{
+    if (index >= getSize())
+    {
+        LOG("ERR: Out of range");
+        return ERR_OUT_OF_RANGE;
+    }
+
+    p_element = m_mapping->copy(index);
+    if (!p_element)
+    {
+        LOG("ERR: Not enough memory");
+        return ERR_MEMORY_ALLOCATION;
+    }
+    return ERR_OK;
+}
+
+int Set_M::contains(IVector const* const p_element, bool& result) const
+{
+    if (!p_element)
+    {
+        LOG("ERR: Incorrect argument");
+        return ERR_WRONG_ARG;
+    }
+    const unsigned int dim = m_mapping->header().dim;
+    if (dim != p_element->getDim())
+    {
+        LOG("ERR: Dimensions mismatch");
+        return ERR_DIMENSIONS_MISMATCH;
+    }
+
+    QVector<double> buffer;
+    double const* coords;
+    int errType = coordsOf(p_element, buffer, coords);
+    if (errType != ERR_OK)
+        return errType;
+
+    // Same rule as IVector::eq() with NORM_INF, compared in place
+    const bool narrow = m_mapping->header().precision == IVector::PRECISION_FLOAT;
+    result = false;
+    for (unsigned int i = 0; i < getSize() && !result; i++)
+    {
+        uchar const* vector = m_mapping->vector(i);
+        unsigned int j = 0;
+        for (; j < dim; j++)
+        {
+            const double coord = narrow ? reinterpret_cast<float const*>(vector)[j]
+                                        : reinterpret_cast<double const*>(vector)[j];
+            if (!(std::fabs(coord - coords[j]) < EPS))
+                break;
+        }
+        result = j == dim;
+    }
+    return ERR_OK;
+}
+
+ISet::IIterator* Set_M::createIterator(unsigned int pos)
+{
+    if (getSize() == 0)
+    {
+        LOG("ERR: Iterator of empty set");
+        return nullptr;
+    }
+    Iterator_M* iterator = new(std::nothrow) Iterator_M(this, pos);
+    if (!iterator)
+    {
+        LOG("ERR: Not enough memory");
+        return nullptr;
+    }
+    m_ptr_iterators.append(iterator);
+    return iterator;
+}
+
+ISet::IIterator* Set_M::begin()
+{
+    return createIterator(0);
+}
+
+ISet::IIterator* Set_M::end()
+{
+    return createIterator(getSize() - 1);
+}
+
+int Set_M::findIterator(ISet::IIterator const * pIter) const
+{
+    for (int i = 0; i < m_ptr_iterators.size(); i++)
+    {
+        if (m_ptr_iterators[i] == pIter)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Set_M::deleteIterator(IIterator * pIter)
+{
+    if (!pIter)
+    {
+        LOG("ERR: Incorrect argument");
+        return ERR_WRONG_ARG;
+    }
+
+    int indIterator = findIterator(pIter);
+    if (indIterator == -1)
+    {
+        LOG("ERR: Failed to find iterator");
+        return ERR_WRONG_ARG;
+    }
+
+    delete m_ptr_iterators[indIterator];
+    m_ptr_iterators.remove(indIterator);
+    return ERR_OK;
+}
+
+int Set_M::getByIterator(IIterator const* pIter, IVector*& p_element) const
+{
+    int indIterator = findIterator(pIter);
+    if (indIterator == -1)
+    {
+        LOG("ERR: Failed to find iterator");
+        return ERR_WRONG_ARG;
+    }
+    return get(m_ptr_iterators[indIterator]->m_pos, p_element);
+}
+
+int Set_M::Iterator_M::next()
+{
+    if (m_pos + 1 >= m_set->getSize())
+    {
+        LOG("ERR: Iterator was last");
+        return ERR_OUT_OF_RANGE;
+    }
+    m_pos++;
+    return ERR_OK;
+}
+
+int Set_M::Iterator_M::prev()
+{
+    if (m_pos == 0)
+    {
+        LOG("ERR: Iterator was first");
+        return ERR_OUT_OF_RANGE;
+    }
+    m_pos--;
+    return ERR_OK;
+}
+
+bool Set_M::Iterator_M::isEnd() const
+{
+    return m_pos == m_set->getSize() - 1;
+}
+
+bool Set_M::Iterator_M::isBegin() const
+{
+    return m_pos == 0;
+}
+
+Set_M::Iterator_M::Iterator_M(
+    ISet const* const set,
+    unsigned int pos)
+  : ISet::IIterator(set, static_cast<int>(pos)),
+    m_set(set), m_pos(pos)
+{
+}
@@ -3,217 +3,899 @@
 #include <logging.h>
 #include <error.h>
 #include <cmath>
+#include <new>
+#include "vector/kernels.h"
+#include "vector/parallel.h"
+#include "vector/storage.h"
+#include "vector/Vector_0.h"
+#include "vector/Vector_N.h"
 //#include "vector.h"
 
-namespace {
-class Vector_0: public IVector{
-public:
-
-//    enum InterfaceTypes
-//    {
-//        INTERFACE_0,
-//        DIMENSION_INTERFACE_IMPL
-//    };
-
-//    enum NormType
-//    {
-//        NORM_1,
-//        NORM_2,
-//        NORM_INF,
-//        DIMENSION_NORM
-//    };
-
-     int getId() const;
-
-    /*factories*/
-    // static IVector* createVector(unsigned int size, double const* vals);
-
-    /*operations*/
-     int add(IVector const* const right);
-     int subtract(IVector const* const right);
-     int multiplyByScalar(double scalar) ;
-     int dotProduct(IVector const* const right, double& res) const;
-     int crossProduct(IVector const* const right)
-    {
-        qt_assert("NOT IMPLEMENTED", __FILE__, __LINE__);
-        return ERR_NOT_IMPLEMENTED;
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+    /// \brief Coordinates copied at once from operands without dense storage
+    static const size_t blockSize = 512;
+
+    /// \brief Copies coordinates [begin, begin + len) of vector into buffer
+    int readBlock(IVector const* const vector, size_t begin, size_t len, double* buffer)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            int errType = vector->getCoord(begin + i, buffer[i]);
+            if (errType != ERR_OK)
+            {
+                LOG("ERR: Failed to get coordinate");
+                return errType;
+            }
+        }
+        return ERR_OK;
+    }
+
+    /// \brief Reads every coordinate of vector, so operations on vectors
+    /// without storage fail before they change anything
+    int checkCoords(IVector const* const vector, size_t size)
+    {
+        double coord;
+        for (size_t i = 0; i < size; i++)
+        {
+            int errType = vector->getCoord(i, coord);
+            if (errType != ERR_OK)
+            {
+                LOG("ERR: Failed to get coordinate");
+                return errType;
+            }
+        }
+        return ERR_OK;
+    }
+
+    /// \brief Calls apply(begin, block, len) for blocks of coordinates of
+    /// vector without storage after all of them are checked
+    template <typename Apply>
+    int applyByBlocks(IVector const* const vector, size_t size, Apply apply)
+    {
+        int errType = checkCoords(vector, size);
+        if (errType != ERR_OK)
+            return errType;
+
+        double block[blockSize];
+        for (size_t begin = 0; begin < size; begin += blockSize)
+        {
+            const size_t len = size - begin < blockSize ? size - begin : blockSize;
+            if ((errType = readBlock(vector, begin, len, block)) != ERR_OK)
+                return errType;
+            apply(begin, block, len);
+        }
+        return ERR_OK;
+    }
+
+    /* ---- Coordinate functions of generic elementwise operations ---- */
+
+    double absoluteOp(double c, double, double) { return fabs(c); }
+    double signumOp(double c, double, double)   { return c > 0 ? 1.0 : c < 0 ? -1.0 : 0.0; }
+    double clampOp(double c, double lo, double hi)
+    {
+        const double t = lo > c ? lo : c;
+        return hi < t ? hi : t;
+    }
+    double minOp(double c, double r, double)      { return c < r ? c : r; }
+    double maxOp(double c, double r, double)      { return c > r ? c : r; }
+    double hadamardOp(double c, double r, double) { return c * r; }
+    double fmaOp(double c, double x, double y)    { return c + x * y; }
+
+    /// \brief self = op(self, x, y) through getCoord() and setCoord()
+    int applyByCoords(IVector* const self, double (*op)(double, double, double),
+                      IVector const* const x, IVector const* const y)
+    {
+        const unsigned int dim = self->getDim();
+        if ((x && x->getDim() != dim) || (y && y->getDim() != dim))
+        {
+            LOG("ERR: Dimensions mismatch");
+            return ERR_DIMENSIONS_MISMATCH;
+        }
+
+        // Every coordinate is read once before any is set, so failure changes nothing
+        int errType;
+        if ((errType = checkCoords(self, dim)) != ERR_OK ||
+            (x && (errType = checkCoords(x, dim)) != ERR_OK) ||
+            (y && (errType = checkCoords(y, dim)) != ERR_OK))
+            return errType;
+
+        for (unsigned int i = 0; i < dim; i++)
+        {
+            double c, xc = 0, yc = 0;
+            if ((errType = self->getCoord(i, c)) != ERR_OK ||
+                (x && (errType = x->getCoord(i, xc)) != ERR_OK) ||
+                (y && (errType = y->getCoord(i, yc)) != ERR_OK))
+            {
+                LOG("ERR: Failed to get coordinate");
+                return errType;
+            }
+            if ((errType = self->setCoord(i, op(c, xc, yc))) != ERR_OK)
+            {
+                LOG("ERR: Failed to set coordinate");
+                return errType;
+            }
+        }
+        return ERR_OK;
+    }
+} /* PIMPL_NAMESPACE */
+
+double const* vector_impl::denseCoords(IVector const* const vector)
+{
+    unsigned int dim;
+    double const* coords;
+    if (vector->getCoordsPtr(dim, coords) != ERR_OK)
+        return NULL;
+    return coords;
+}
+
+VectorOperand::VectorOperand(IVector const* const vector)
+  : m_coords(denseCoords(vector)),
+    m_copy(NULL),
+    m_result(ERR_OK)
+{
+    if (m_coords)
+        return;
+
+    const unsigned int dim = vector->getDim();
+    m_copy = new(std::nothrow) double[dim ? dim : 1];
+    if (!m_copy)
+    {
+        m_result = ERR_MEMORY_ALLOCATION;
+        return;
+    }
+    for (unsigned int i = 0; i < dim && m_result == ERR_OK; ++i)
+    {
+        m_result = vector->getCoord(i, m_copy[i]);
+    }
+    m_coords = m_copy;
+}
+
+unsigned int IVector::getAlignment() const
+{
+    return static_cast<unsigned int>(storage::alignmentOf(denseCoords(this)));
+}
+
+int Vector_0::getId() const
+{
+    return IVector::INTERFACE_0;
+}
+
+SharedVals* SharedVals::create(unsigned int size, double const* vals)
+{
+    void* mem = storage::allocate(header + size * sizeof(double));
+    if (!mem)
+    {
+        LOG("ERR: Not enough memory");
+        return NULL;
     }
 
-//    /*static operations*/
-//    static IVector* add(IVector const* const left, IVector const* const right);
-//    static IVector* subtract(IVector const* const left, IVector const* const right);
-//    static IVector* multiplyByScalar(IVector const* const left, double scalar);
-//    static IVector* crossProduct(IVector const* const left, IVector const* const right)
-//    {
-//        //qt_assert("NOT IMPLEMENTED", __FILE__, __LINE__);
-//        return static_cast<IVector*>(0);
-//    }
+    SharedVals* shared = static_cast<SharedVals*>(mem);
+    shared->refs.store(1, std::memory_order_relaxed);
+
+    double* valsNew = shared->vals();
+    for(size_t i = 0; i < size; i++)
+    {
+        valsNew[i] = vals ? vals[i] : 0.0;
+    }
+    return shared;
+}
+
+void SharedVals::release()
+{
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        storage::release(this);
+}
+
+Vector_0::Vector_0(unsigned int size, double *vals)
+  : m_vals(vals),
+    m_size(size),
+    m_ownsVals(true),
+    m_shared(NULL),
+    m_normsValid(false),
+    m_cacheNorms(false),
+    m_pinned(false)
+{
+
+}
+
+Vector_0::Vector_0(unsigned int size, double *vals, bool ownsVals)
+  : m_vals(vals),
+    m_size(size),
+    m_ownsVals(ownsVals),
+    m_shared(NULL),
+    m_normsValid(false),
+    m_cacheNorms(false),
+    m_pinned(false)
+{
+
+}
+
+Vector_0::Vector_0(unsigned int size, SharedVals* shared)
+  : m_vals(shared->vals()),
+    m_size(size),
+    m_ownsVals(false),
+    m_shared(shared),
+    m_normsValid(false),
+    m_cacheNorms(false),
+    m_pinned(false)
+{
+
+}
+
+int Vector_0::detach()
+{
+    m_normsValid = false;
+
+    if (!m_shared || !m_shared->isShared())
+        return ERR_OK;
+
+    SharedVals* own = SharedVals::create(m_size, m_vals);
+    if (!own)
+        return ERR_MEMORY_ALLOCATION;
+
+    m_shared->release();
+    m_shared = own;
+    m_vals = own->vals();
+    return ERR_OK;
+}
+
+int Vector_0::pin()
+{
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+    m_pinned = true;
+    m_cacheNorms = false;
+    return ERR_OK;
+}
+
+Vector_S::Vector_S(unsigned int size, double *vals)
+  : Vector_0(size, vals, false)
+{
+
+}
+
+Vector_S* Vector_S::create(unsigned int size, double const* vals)
+{
+    const size_t offset = storage::alignUp(sizeof(Vector_S));
+    void* mem = storage::allocate(offset + size * sizeof(double));
+    if (!mem)
+    {
+        LOG("ERR: Not enough memory");
+        return NULL;
+    }
+
+    double* valsInline = reinterpret_cast<double*>(static_cast<char*>(mem) + offset);
+    for(size_t i = 0; i < size; i++)
+    {
+        valsInline[i] = vals ? vals[i] : 0.0;
+    }
+
+    return new(mem) Vector_S(size, valsInline);
+}
+
+//IVector::~IVector()
+//{
+//    delete[] m_vals;
+//}
+
+//IVector* IVector::createVector(unsigned int size, double const* vals)
+IVector* IVector::createVector(unsigned int size, double const* vals)
+{
+    switch (size)
+    {
+    case 2: return Vector_N<2>::create(vals);
+    case 3: return Vector_N<3>::create(vals);
+    case 4: return Vector_N<4>::create(vals);
+    case 8: return Vector_N<8>::create(vals);
+    default: break;
+    }
+
+    if (size <= Vector_S::maxDim)
+    {
+        return Vector_S::create(size, vals);
+    }
+
+    SharedVals* valsNew = SharedVals::create(size, vals);
+    if (!valsNew)
+    {
+        return NULL;
+    }
+
+   // IVector *vect = new(std::nothrow) IVector(size, valsNew);
+    IVector *vect = new(std::nothrow) Vector_0(size, valsNew);
+    if (!vect)
+    {
+        LOG("ERR: Not enough memory");
+        valsNew->release();
+        return NULL;
+    }
+
+    return vect;
+}
+
+IVector* IVector::createView(unsigned int size, double* vals)
+{
+    if (!vals && size > 0)
+    {
+        LOG("ERR: NULL pointer");
+        return NULL;
+    }
+
+    Vector_0 *vect = new(std::nothrow) Vector_0(size, vals, false);
+    if (!vect)
+    {
+        LOG("ERR: Not enough memory");
+        return NULL;
+    }
+
+    // Owner of vals may change them behind the view
+    vect->pin();
+    return vect;
+}
+
+IVector* IVector::adoptVector(unsigned int size, double* vals)
+{
+    if (!vals && size > 0)
+    {
+        LOG("ERR: NULL pointer");
+        return NULL;
+    }
+
+    IVector *vect = new(std::nothrow) Vector_0(size, vals, true);
+    if (!vect)
+    {
+        LOG("ERR: Not enough memory");
+        delete[] vals;
+        return NULL;
+    }
+
+    return vect;
+}
+
+void IVector::setParallelThreshold(unsigned int dim)
+{
+    parallel::setThreshold(dim);
+}
+
+unsigned int IVector::getParallelThreshold()
+{
+    return static_cast<unsigned int>(parallel::threshold());
+}
+
+void IVector::setParallelThreads(unsigned int threads)
+{
+    parallel::setThreads(threads);
+}
+
+unsigned int IVector::getParallelThreads()
+{
+    return parallel::concurrency();
+}
+
+unsigned long long IVector::getStorageAllocations()
+{
+    return storage::allocations();
+}
+
+//int IVector::add(IVector const* const right)
+int Vector_0::add(IVector const* const right)
+{
+    if (!right)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    if (m_size != right->getDim())
+    {
+        LOG("ERR: Dimensions mismatch");
+        return ERR_DIMENSIONS_MISMATCH;
+    }
+
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+
+    double const* rightVals = denseCoords(right);
+    if (rightVals)
+    {
+        parallel::tableFor(m_size).add(m_vals, m_vals, rightVals, m_size);
+        return ERR_OK;
+    }
+
+    SparseCoords rightSparse;
+    if (sparseCoords(right, rightSparse))
+    {
+        for (unsigned int k = 0; k < rightSparse.nnz; k++)
+        {
+            m_vals[rightSparse.indices[k]] += rightSparse.vals[k];
+        }
+        return ERR_OK;
+    }
+
+    const kernels::Table& t = kernels::table();
+    double* vals = m_vals;
+    return applyByBlocks(right, m_size, [&](size_t begin, double const* block, size_t len) {
+        t.add(vals + begin, vals + begin, block, len);
+    });
+}
+
+//int IVector::subtract(IVector const* const right)
+int Vector_0::subtract(IVector const* const right)
+{
+    if (!right)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    if (m_size != right->getDim())
+    {
+        LOG("ERR: Dimensions mismatch");
+        return ERR_DIMENSIONS_MISMATCH;
+    }
+
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+
+    double const* rightVals = denseCoords(right);
+    if (rightVals)
+    {
+        parallel::tableFor(m_size).subtract(m_vals, m_vals, rightVals, m_size);
+        return ERR_OK;
+    }
+
+    SparseCoords rightSparse;
+    if (sparseCoords(right, rightSparse))
+    {
+        for (unsigned int k = 0; k < rightSparse.nnz; k++)
+        {
+            m_vals[rightSparse.indices[k]] -= rightSparse.vals[k];
+        }
+        return ERR_OK;
+    }
+
+    const kernels::Table& t = kernels::table();
+    double* vals = m_vals;
+    return applyByBlocks(right, m_size, [&](size_t begin, double const* block, size_t len) {
+        t.subtract(vals + begin, vals + begin, block, len);
+    });
+}
+
+int Vector_0::multiplyByScalar(double scalar)
+{
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+
+    parallel::tableFor(m_size).scale(m_vals, m_vals, scalar, m_size);
+    return ERR_OK;
+}
+
+int Vector_0::axpy(double alpha, IVector const* const x)
+{
+    if (!x)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    if (m_size != x->getDim())
+    {
+        LOG("ERR: Dimensions mismatch");
+        return ERR_DIMENSIONS_MISMATCH;
+    }
+
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+
+    double const* xVals = denseCoords(x);
+    if (xVals)
+    {
+        parallel::tableFor(m_size).axpy(m_vals, alpha, xVals, m_size);
+        return ERR_OK;
+    }
+
+    SparseCoords xSparse;
+    if (sparseCoords(x, xSparse))
+    {
+        for (unsigned int k = 0; k < xSparse.nnz; k++)
+        {
+            m_vals[xSparse.indices[k]] += alpha * xSparse.vals[k];
+        }
+        return ERR_OK;
+    }
+
+    const kernels::Table& t = kernels::table();
+    double* vals = m_vals;
+    return applyByBlocks(x, m_size, [&](size_t begin, double const* block, size_t len) {
+        t.axpy(vals + begin, alpha, block, len);
+    });
+}
+
+int Vector_0::axpby(double alpha, IVector const* const x, double beta)
+{
+    if (!x)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    if (m_size != x->getDim())
+    {
+        LOG("ERR: Dimensions mismatch");
+        return ERR_DIMENSIONS_MISMATCH;
+    }
+
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+
+    double const* xVals = denseCoords(x);
+    if (xVals)
+    {
+        parallel::tableFor(m_size).axpby(m_vals, alpha, xVals, beta, m_size);
+        return ERR_OK;
+    }
+
+    SparseCoords xSparse;
+    if (sparseCoords(x, xSparse))
+    {
+        parallel::tableFor(m_size).scale(m_vals, m_vals, beta, m_size);
+        for (unsigned int k = 0; k < xSparse.nnz; k++)
+        {
+            m_vals[xSparse.indices[k]] += alpha * xSparse.vals[k];
+        }
+        return ERR_OK;
+    }
+
+    const kernels::Table& t = kernels::table();
+    double* vals = m_vals;
+    return applyByBlocks(x, m_size, [&](size_t begin, double const* block, size_t len) {
+        t.axpby(vals + begin, alpha, block, beta, len);
+    });
+}
+
+int Vector_0::linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors)
+{
+    if (count > 0 && (!coefs || !vectors))
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
 
-    /*comparators*/
-     int gt(IVector const* const right, NormType type, bool& result) const ;
-     int lt(IVector const* const right, NormType type, bool& result) const ;
-     int eq(IVector const* const right, NormType type, bool& result, double precision) const;
+    /// Terms pointers are kept on stack for usual short combinations
+    static const unsigned int stackTerms = 8;
+    double const* stackVals[stackTerms];
+    double const** termVals = count <= stackTerms ?
+                stackVals : new(std::nothrow) double const*[count];
+    if (!termVals)
+    {
+        LOG("ERR: Not enough memory");
+        return ERR_MEMORY_ALLOCATION;
+    }
 
-    /*utils*/
-     unsigned int getDim() const ;
-     int norm(NormType type, double& res) const ;
-     int setCoord(unsigned int index, double elem) ;
-     int getCoord(unsigned int index, double & elem) const ;
-     int setAllCoords(unsigned int dim, double* coords) ;
-     int getCoordsPtr(unsigned int & dim, double const*& elem) const;
-     IVector* clone() const ;
+    bool allDense = true;
+    for (unsigned int k = 0; k < count; k++)
+    {
+        if (!vectors[k])
+        {
+            LOG("ERR: NULL pointer");
+            if (termVals != stackVals)
+                delete[] termVals;
+            return ERR_WRONG_ARG;
+        }
+        if (m_size != vectors[k]->getDim())
+        {
+            LOG("ERR: Dimensions mismatch");
+            if (termVals != stackVals)
+                delete[] termVals;
+            return ERR_DIMENSIONS_MISMATCH;
+        }
+        termVals[k] = denseCoords(vectors[k]);
+        allDense = allDense && termVals[k];
+    }
 
-     /*ctor*/
-      Vector_0(unsigned int size, double *vals);
+    // Terms without storage are checked first, so failure leaves vector intact
+    for (unsigned int k = 0; k < count && errType == ERR_OK; k++)
+    {
+        if (!termVals[k])
+            errType = checkCoords(vectors[k], m_size);
+    }
 
-    /*dtor*/
-     ~Vector_0(){
-         delete[] m_vals;
-     }
+    if (errType == ERR_OK && allDense)
+    {
+        kernels::linearCombination(m_vals, count, coefs, termVals, m_size);
+    }
+    else for(size_t i = 0; i < m_size && errType == ERR_OK; i++)
+    {
+        double coord;
+        double resTmp = 0;
+        for (unsigned int k = 0; k < count; k++)
+        {
+            errType = vectors[k]->getCoord(i, coord);
+            if (errType != ERR_OK)
+            {
+                LOG("ERR: Failed to get coordinate");
+                break;
+            }
+            resTmp += coefs[k] * coord;
+        }
+        if (errType == ERR_OK)
+            m_vals[i] = resTmp;
+    }
 
-    protected:
-    Vector_0() = default;
+    if (termVals != stackVals)
+        delete[] termVals;
+    return errType;
+}
 
-    private:
-    double* m_vals;
-    size_t m_size;
+int IVector::absolute()
+{
+    return applyByCoords(this, absoluteOp, NULL, NULL);
+}
 
-    /*non default copyable*/
-    Vector_0(const IVector& other) = delete;
-    void operator=(const Vector_0& other) = delete;
-};
+int IVector::signum()
+{
+    return applyByCoords(this, signumOp, NULL, NULL);
 }
 
-int Vector_0::getId() const
+int IVector::clamp(IVector const* const lower, IVector const* const upper)
 {
-    return IVector::INTERFACE_0;
+    if (!lower || !upper)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    return applyByCoords(this, clampOp, lower, upper);
 }
 
-Vector_0::Vector_0(unsigned int size, double *vals)
-  : m_vals(vals),
-    m_size(size)
+int IVector::elementwiseMin(IVector const* const right)
 {
+    if (!right)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    return applyByCoords(this, minOp, right, NULL);
+}
 
+int IVector::elementwiseMax(IVector const* const right)
+{
+    if (!right)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    return applyByCoords(this, maxOp, right, NULL);
 }
 
-//IVector::~IVector()
-//{
-//    delete[] m_vals;
-//}
+int IVector::hadamardProduct(IVector const* const right)
+{
+    if (!right)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    return applyByCoords(this, hadamardOp, right, NULL);
+}
 
-//IVector* IVector::createVector(unsigned int size, double const* vals)
-IVector* IVector::createVector(unsigned int size, double const* vals)
+int IVector::fusedMultiplyAdd(IVector const* const x, IVector const* const y)
 {
-    double *valsNew = new(std::nothrow) double[size];
-    if (!valsNew)
+    if (!x || !y)
     {
-        LOG("ERR: Not enough memory");
-        return NULL;
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
     }
+    return applyByCoords(this, fmaOp, x, y);
+}
 
-    for(size_t i = 0; i < size; i++)
+int Vector_0::absolute()
+{
+    int errType = detach();
+    if (errType != ERR_OK)
     {
-        valsNew[i] = vals[i];
+        LOG("ERR: Not enough memory");
+        return errType;
     }
 
-   // IVector *vect = new(std::nothrow) IVector(size, valsNew);
-    IVector *vect = new(std::nothrow) Vector_0(size, valsNew);
-    if (!vect)
+    parallel::tableFor(m_size).absolute(m_vals, m_vals, m_size);
+    return ERR_OK;
+}
+
+int Vector_0::signum()
+{
+    int errType = detach();
+    if (errType != ERR_OK)
     {
         LOG("ERR: Not enough memory");
-        delete[] valsNew;
-        return NULL;
+        return errType;
     }
 
-    return vect;
+    parallel::tableFor(m_size).signum(m_vals, m_vals, m_size);
+    return ERR_OK;
 }
 
-//int IVector::add(IVector const* const right)
-int Vector_0::add(IVector const* const right)
+int Vector_0::clamp(IVector const* const lower, IVector const* const upper)
 {
-    if (!right)
+    if (!lower || !upper)
     {
         LOG("ERR: NULL pointer");
         return ERR_WRONG_ARG;
     }
-    if (m_size != right->getDim())
+    if (m_size != lower->getDim() || m_size != upper->getDim())
     {
         LOG("ERR: Dimensions mismatch");
         return ERR_DIMENSIONS_MISMATCH;
     }
 
+    // Operands without storage are read through before anything changes
+    double const* lowerVals = denseCoords(lower);
+    double const* upperVals = denseCoords(upper);
     int errType;
-    double coord;
-    double *valsTmp = new(std::nothrow) double[m_size];
-    if (!valsTmp)
+    if ((!lowerVals && (errType = checkCoords(lower, m_size)) != ERR_OK) ||
+        (!upperVals && (errType = checkCoords(upper, m_size)) != ERR_OK))
+        return errType;
+
+    errType = detach();
+    if (errType != ERR_OK)
     {
         LOG("ERR: Not enough memory");
-        return ERR_MEMORY_ALLOCATION;
+        return errType;
     }
 
-    for(size_t i = 0; i < m_size; i++)
+    if (lowerVals && upperVals)
     {
-        errType = right->getCoord(i, coord);
-        if (errType != ERR_OK)
-        {
-            LOG("ERR: Failed to get coordinate");
-            delete[] valsTmp;
-            return errType;
-        }
-        valsTmp[i] = m_vals[i] + coord;
+        parallel::tableFor(m_size).clamp(m_vals, m_vals, lowerVals, upperVals, m_size);
+        return ERR_OK;
     }
 
-    delete[] m_vals;
-    m_vals = valsTmp;
+    const kernels::Table& t = kernels::table();
+    double lowerBlock[blockSize];
+    double upperBlock[blockSize];
+    for (size_t begin = 0; begin < m_size; begin += blockSize)
+    {
+        const size_t len = m_size - begin < blockSize ? m_size - begin : blockSize;
+        if ((!lowerVals && (errType = readBlock(lower, begin, len, lowerBlock)) != ERR_OK) ||
+            (!upperVals && (errType = readBlock(upper, begin, len, upperBlock)) != ERR_OK))
+            return errType;
 
+        t.clamp(m_vals + begin, m_vals + begin,
+                lowerVals ? lowerVals + begin : lowerBlock,
+                upperVals ? upperVals + begin : upperBlock, len);
+    }
     return ERR_OK;
 }
 
-//int IVector::subtract(IVector const* const right)
-int Vector_0::subtract(IVector const* const right)
+int Vector_0::elementwiseMin(IVector const* const right)
 {
-    if (!right)
+    return elementwise(&kernels::Table::minimum, right);
+}
+
+int Vector_0::elementwiseMax(IVector const* const right)
+{
+    return elementwise(&kernels::Table::maximum, right);
+}
+
+int Vector_0::hadamardProduct(IVector const* const right)
+{
+    return elementwise(&kernels::Table::multiply, right);
+}
+
+int Vector_0::fusedMultiplyAdd(IVector const* const x, IVector const* const y)
+{
+    if (!x || !y)
     {
         LOG("ERR: NULL pointer");
         return ERR_WRONG_ARG;
     }
-    if (m_size != right->getDim())
+    if (m_size != x->getDim() || m_size != y->getDim())
     {
         LOG("ERR: Dimensions mismatch");
         return ERR_DIMENSIONS_MISMATCH;
     }
+
+    double const* xVals = denseCoords(x);
+    double const* yVals = denseCoords(y);
     int errType;
-    double coord;
-    double *valsTmp = new(std::nothrow) double[m_size];
-    if (!valsTmp)
+    if ((!xVals && (errType = checkCoords(x, m_size)) != ERR_OK) ||
+        (!yVals && (errType = checkCoords(y, m_size)) != ERR_OK))
+        return errType;
+
+    errType = detach();
+    if (errType != ERR_OK)
     {
         LOG("ERR: Not enough memory");
-        return ERR_MEMORY_ALLOCATION;
+        return errType;
     }
 
-    for(size_t i = 0; i < m_size; i++)
+    if (xVals && yVals)
     {
-        errType = right->getCoord(i, coord);
-        if (errType != ERR_OK)
-        {
-            LOG("ERR: Failed to get coordinate");
-            delete[] valsTmp;
-            return errType;
-        }
-        valsTmp[i] = m_vals[i] - coord;
+        parallel::tableFor(m_size).fma(m_vals, xVals, yVals, m_size);
+        return ERR_OK;
     }
 
-    delete[] m_vals;
-    m_vals = valsTmp;
+    const kernels::Table& t = kernels::table();
+    double xBlock[blockSize];
+    double yBlock[blockSize];
+    for (size_t begin = 0; begin < m_size; begin += blockSize)
+    {
+        const size_t len = m_size - begin < blockSize ? m_size - begin : blockSize;
+        if ((!xVals && (errType = readBlock(x, begin, len, xBlock)) != ERR_OK) ||
+            (!yVals && (errType = readBlock(y, begin, len, yBlock)) != ERR_OK))
+            return errType;
 
+        t.fma(m_vals + begin, xVals ? xVals + begin : xBlock, yVals ? yVals + begin : yBlock, len);
+    }
     return ERR_OK;
 }
 
-int Vector_0::multiplyByScalar(double scalar)
+int Vector_0::elementwise(BinaryKernel kernels::Table::* kernel, IVector const* const right)
 {
-    for(size_t i = 0; i < m_size; i++)
+    if (!right)
+    {
+        LOG("ERR: NULL pointer");
+        return ERR_WRONG_ARG;
+    }
+    if (m_size != right->getDim())
+    {
+        LOG("ERR: Dimensions mismatch");
+        return ERR_DIMENSIONS_MISMATCH;
+    }
+
+    double const* rightVals = denseCoords(right);
+    int errType;
+    if (!rightVals && (errType = checkCoords(right, m_size)) != ERR_OK)
+        return errType;
+
+    errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+
+    if (rightVals)
     {
-        m_vals[i] *= scalar;
+        (parallel::tableFor(m_size).*kernel)(m_vals, m_vals, rightVals, m_size);
+        return ERR_OK;
+    }
+
+    const kernels::Table& t = kernels::table();
+    double rightBlock[blockSize];
+    for (size_t begin = 0; begin < m_size; begin += blockSize)
+    {
+        const size_t len = m_size - begin < blockSize ? m_size - begin : blockSize;
+        if ((errType = readBlock(right, begin, len, rightBlock)) != ERR_OK)
+            return errType;
+
+        (t.*kernel)(m_vals + begin, m_vals + begin, rightBlock, len);
     }
     return ERR_OK;
 }
@@ -231,6 +913,25 @@ int Vector_0::dotProduct(IVector const* const right, double& res) const
         LOG("ERR: Dimensions mismatch");
         return ERR_DIMENSIONS_MISMATCH;
     }
+    double const* rightVals = denseCoords(right);
+    if (rightVals)
+    {
+        res = parallel::tableFor(m_size).dot(m_vals, rightVals, m_size);
+        return ERR_OK;
+    }
+
+    SparseCoords rightSparse;
+    if (sparseCoords(right, rightSparse))
+    {
+        double resSparse = 0;
+        for (unsigned int k = 0; k < rightSparse.nnz; k++)
+        {
+            resSparse += m_vals[rightSparse.indices[k]] * rightSparse.vals[k];
+        }
+        res = resSparse;
+        return ERR_OK;
+    }
+
     int errType;
     double coord;
     double resTmp = 0;
@@ -257,30 +958,27 @@ unsigned int Vector_0::getDim() const
 
 int Vector_0::norm(NormType type, double& res) const
 {
-    res = 0;
-    switch (type)
+    if (m_cacheNorms && type >= NORM_1 && type < DIMENSION_NORM)
     {
-    case NORM_1:
-        for (size_t i = 0; i < m_size; i++)
+        if (!m_normsValid)
         {
-            res += fabs(m_vals[i]);
+            norms(m_norms[NORM_1], m_norms[NORM_2], m_norms[NORM_INF]);
+            m_normsValid = true;
         }
+        res = m_norms[type];
+        return ERR_OK;
+    }
+
+    switch (type)
+    {
+    case NORM_1:
+        res = parallel::tableFor(m_size).norm1(m_vals, m_size);
         break;
     case NORM_2:
-        for (size_t i = 0; i < m_size; i++)
-        {
-            res += m_vals[i] * m_vals[i];
-        }
-        res = sqrt(res);
+        res = sqrt(parallel::tableFor(m_size).norm2sq(m_vals, m_size));
         break;
     case NORM_INF:
-        for (size_t i = 0; i < m_size; i++)
-        {
-            if (res < fabs(m_vals[i]))
-            {
-                res = fabs(m_vals[i]);
-            }
-        }
+        res = parallel::tableFor(m_size).normInf(m_vals, m_size);
         break;
     default:
         LOG("ERR: Unknown norm type");
@@ -289,6 +987,28 @@ int Vector_0::norm(NormType type, double& res) const
     return ERR_OK;
 }
 
+int Vector_0::norms(double& norm1, double& norm2, double& normInf) const
+{
+    double res[DIMENSION_NORM];
+    parallel::tableFor(m_size).norms(m_vals, m_size, res);
+    norm1 = res[NORM_1];
+    norm2 = sqrt(res[NORM_2]);
+    normInf = res[NORM_INF];
+    return ERR_OK;
+}
+
+int Vector_0::cacheNorms(bool enable)
+{
+    if (enable && m_pinned)
+    {
+        LOG("ERR: Coordinates may be changed outside of vector");
+        return ERR_NOT_IMPLEMENTED;
+    }
+    m_cacheNorms = enable;
+    m_normsValid = false;
+    return ERR_OK;
+}
+
 int Vector_0::setCoord(unsigned int index, double elem)
 {
     if (index > m_size - 1)
@@ -296,6 +1016,12 @@ int Vector_0::setCoord(unsigned int index, double elem)
         LOG("ERR: Out of range");
         return ERR_OUT_OF_RANGE;
     }
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
     m_vals[index] = elem;
     return ERR_OK;
 }
@@ -323,6 +1049,12 @@ int Vector_0::setAllCoords(unsigned int dim, double* coords)
         LOG("ERR: NULL pointer");
         return ERR_WRONG_ARG;
     }
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
     for(size_t i = 0; i < m_size; i++)
     {
         m_vals[i] = coords[i];
@@ -337,6 +1069,31 @@ int Vector_0::getCoordsPtr(unsigned int & dim, double const*& elem) const
     return ERR_OK;
 }
 
+int Vector_0::getMutableCoordsPtr(unsigned int & dim, double*& elem)
+{
+    // Caller may write through pointer at any time, so clones must not share it
+    int errType = pin();
+    if (errType != ERR_OK)
+        return errType;
+    dim = m_size;
+    elem = m_vals;
+    return ERR_OK;
+}
+
+int Vector_0::getUpdateCoordsPtr(unsigned int & dim, double*& elem)
+{
+    // Writes happen right away, detach() is enough to keep sharing and cache correct
+    int errType = detach();
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Not enough memory");
+        return errType;
+    }
+    dim = m_size;
+    elem = m_vals;
+    return ERR_OK;
+}
+
 //IVector* IVector::clone() const
 //{
 //    return createVector(m_size, m_vals);
@@ -344,7 +1101,19 @@ int Vector_0::getCoordsPtr(unsigned int & dim, double const*& elem) const
 
 IVector* Vector_0::clone() const
 {
-    return createVector(m_size, m_vals);
+    if (!m_shared || m_pinned)
+        return createVector(m_size, m_vals);
+
+    // Copy is postponed until either vector is changed
+    m_shared->retain();
+    IVector *vect = new(std::nothrow) Vector_0(m_size, m_shared);
+    if (!vect)
+    {
+        LOG("ERR: Not enough memory");
+        m_shared->release();
+        return NULL;
+    }
+    return vect;
 }
 
 //IVector* IVector::add(IVector const* const left, IVector const* const right)
@@ -494,6 +1263,25 @@ int Vector_0::lt(IVector const* const right, NormType type, bool& result) const
 
 //int IVector::eq(IVector const* const right, NormType type, bool& result, double precision) const
 int Vector_0::eq(IVector const* const right, NormType type, bool& result, double precision) const
+{
+    double distanceRes;
+    // Any coordinate off by precision already decides NORM_INF comparison
+    int errType = distanceBounded(right, type, distanceRes, precision);
+    if (errType != ERR_OK)
+    {
+        LOG("ERR: Distance calculating failed");
+        return errType;
+    }
+    result = distanceRes < precision;
+    return ERR_OK;
+}
+
+int Vector_0::distance(IVector const* const right, NormType type, double& res) const
+{
+    return distanceBounded(right, type, res, HUGE_VAL);
+}
+
+int Vector_0::distanceBounded(IVector const* const right, NormType type, double& res, double bound) const
 {
     if (!right)
     {
@@ -505,23 +1293,51 @@ int Vector_0::eq(IVector const* const right, NormType type, bool& result, double
         LOG("ERR: Dimensions mismatch");
         return ERR_DIMENSIONS_MISMATCH;
     }
+    if (type != NORM_1 && type != NORM_2 && type != NORM_INF)
+    {
+        LOG("ERR: Unknown norm type");
+        return ERR_NORM_NOT_DEFINED;
+    }
 
-    //IVector *tmp = IVector::subtract(this, right);
-    IVector *tmp = IVector::subtract(this, right);
-    if (!tmp)
+    double const* rightVals = denseCoords(right);
+    if (rightVals)
     {
-        LOG("ERR: Subtraction failed");
-        return ERR_ANY_OTHER;
+        const kernels::Table& t = parallel::tableFor(m_size);
+        res = type == NORM_1 ? t.distance1(m_vals, rightVals, m_size) :
+              type == NORM_2 ? sqrt(t.distance2sq(m_vals, rightVals, m_size)) :
+                               t.distanceInf(m_vals, rightVals, m_size, bound);
+        return ERR_OK;
     }
+
     int errType;
-    double normRes;
-    errType = tmp->norm(type, normRes);
-    if (errType != ERR_OK)
+    double coord;
+    double resTmp = 0;
+    for(size_t i = 0; i < m_size; i++)
     {
-        LOG("ERR: Norm calculating failed");
-        delete tmp;
-        return errType;
+        errType = right->getCoord(i, coord);
+        if (errType != ERR_OK)
+        {
+            LOG("ERR: Failed to get coordinate");
+            return errType;
+        }
+        const double diff = fabs(m_vals[i] - coord);
+        switch (type)
+        {
+        case NORM_1:
+            resTmp += diff;
+            break;
+        case NORM_2:
+            resTmp += diff * diff;
+            break;
+        default:
+            if (resTmp < diff)
+                resTmp = diff;
+            break;
+        }
+        if (type == NORM_INF && resTmp > bound)
+            break;
     }
-    result = fabs(normRes) < precision;
+
+    res = type == NORM_2 ? sqrt(resTmp) : resTmp;
     return ERR_OK;
 }
@@ -12,6 +12,8 @@
   #include <logging.h>
 #pragma warning(pop)
 
+#include <cmath>
+
 #include <QScopedPointer>
 #include <QSet>
 #include <QVector>
@@ -21,6 +23,15 @@
 #include "common.cpp"
 
 namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Node k of grid with positive increment along one dimension
+  ///
+  /// Iterators and nearest neighbor search both use it, so they give
+  /// the same bits instead of accumulating rounding in different ways.
+  inline double gridNode(double left, double increment, double k)
+  {
+    return left + k * increment;
+  }
+
   /// \brief Abstract compact
   ///
   /// This class shares some common ICompact methods implementations
@@ -105,12 +116,25 @@ namespace /* PIMPL_NAMESPACE */ {
       /// L                      L
       int doStep() ;
 
+      /// \brief Following steps start from current vector
+      int setStep(IVector const* const step = NULL) ;
+
     /// \brief Internal methods
     public:
       Iterator_R(const Compact_R* const parent,
                  IVector* const vector,
                  const IVector* const step);
 
+    private:
+      /// \brief Makes current vector node 0 of grid in every dimension
+      int resetGrid();
+
+    /// \brief Internal variables
+    private:
+      /// \brief Node 0 of grid per dimension
+      QVector<double>    m_anchor;
+      /// \brief Node of current vector per dimension, see gridNode()
+      QVector<long long> m_index;
     };
 
     int isContains(IVector const* const vec, bool& result) const ;
@@ -510,18 +534,21 @@ int Compact_R::Iterator_R::doStep()
         LOG_RET("Failed to get current dimension right boundary: " + std::to_string(currentDim), ERR_ANY_OTHER);
     }
 
-    element += increment;
+    element = gridNode(m_anchor[currentDim], increment, m_index[currentDim] + 1);
     if (element <= rightBound) { /* Move a bit in current dimension */
       result = m_curVector->setCoord(currentDim, element);
       if (result != ERR_OK)
         LOG_RET("Failed to increment current vector", ERR_ANY_OTHER);
 
+      ++m_index[currentDim];
       return ERR_OK;
     } else { /* Start from scratch in higher dimension */
       result = m_curVector->setCoord(currentDim, leftBound);
       if (result != ERR_OK)
         LOG_RET("Failed to increment current vector", ERR_ANY_OTHER);
 
+      m_anchor[currentDim] = leftBound;
+      m_index[currentDim] = 0;
       currentDim += 1;
     }
 
@@ -529,12 +556,41 @@ int Compact_R::Iterator_R::doStep()
   return ERR_OUT_OF_RANGE;
 }
 
+int Compact_R::Iterator_R::setStep(const IVector* const step)
+{
+  int result = AIterator::setStep(step);
+  if (result != ERR_OK)
+    return result;
+
+  return resetGrid();
+}
+
 Compact_R::Iterator_R::Iterator_R(
     const Compact_R* const parent,
     IVector* const vector,
     const IVector* const step)
-  : AIterator(parent, vector, step)
-{  }
+  : AIterator(parent, vector, step),
+    m_anchor(),
+    m_index()
+{
+  const int result = resetGrid();
+  Q_ASSERT(result == ERR_OK);
+  Q_UNUSED(result);
+}
+
+int Compact_R::Iterator_R::resetGrid()
+{
+  const unsigned int dim = m_curVector->getDim();
+  m_anchor.resize(static_cast<int>(dim));
+  m_index.fill(0, static_cast<int>(dim));
+
+  for (unsigned int i = 0; i < dim; ++i) {
+    int result = m_curVector->getCoord(i, m_anchor[static_cast<int>(i)]);
+    if (result != ERR_OK)
+      LOG_RET("Failed to get current vector coordinate: " + std::to_string(i), ERR_ANY_OTHER);
+  }
+  return ERR_OK;
+}
 
 int Compact_R::isContains(const IVector* const vec, bool &result) const
 {
@@ -605,10 +661,24 @@ int Compact_R::getNearestNeighbor(const IVector* vec, IVector*& nn) const
   if (vec->getDim() != compDim)
     LOG_RET("IVector passed has wrong dimension", ERR_DIMENSIONS_MISMATCH);
 
-  QVector<double> neighborVector(static_cast<int>(compDim));
+  // Result holds doubles whatever vec is, so grid nodes are not rounded
+  QScopedPointer<IVector> neighbor(IVector::createVector(compDim, NULL));
+  if (!neighbor)
+    LOG_RET("Failed to create neighbor IVector", ERR_MEMORY_ALLOCATION);
+
+  result = neighbor->add(vec);
+  if (result != ERR_OK)
+    LOG_RET("Failed to copy IVector passed", ERR_ANY_OTHER);
+
+  // Points outside the compact share the nearest grid node with their
+  // projection onto it, so the whole vector is clamped in one pass
+  result = neighbor->clamp(m_leftBound.data(), m_rightBound.data());
+  if (result != ERR_OK)
+    LOG_RET("Failed to clamp IVector passed to the compact", ERR_ANY_OTHER);
+
   for (unsigned int coord = 0; coord < compDim; ++coord) {
-    double iterator;
-    result = m_leftBound->getCoord(coord, iterator);
+    double left;
+    result = m_leftBound->getCoord(coord, left);
     if (result != ERR_OK)
       LOG_RET("Failed to get current dimension left boundary: " + std::to_string(coord), ERR_ANY_OTHER);
 
@@ -623,35 +693,32 @@ int Compact_R::getNearestNeighbor(const IVector* vec, IVector*& nn) const
       LOG_RET("Failed to get current dimension right boundary: " + std::to_string(coord), ERR_ANY_OTHER);
 
     double target;
-    result = vec->getCoord(coord, target);
+    result = neighbor->getCoord(coord, target);
     if (result != ERR_OK)
       LOG_RET("Failed to get current dimension target: " + std::to_string(coord), ERR_ANY_OTHER);
 
-    while (true) {
-      iterator += increment;
-
-      // Edge cases
-      if (iterator > bound) {
-        neighborVector[static_cast<int>(coord)] =
-            std::abs(target - bound) < std::abs(target - (iterator - increment)) ?
-                              bound  :                   (iterator - increment);
-        break;
-      }
-
-      // Inner cases
-      if (iterator > target) {
-        neighborVector[static_cast<int>(coord)] =
-            std::abs(target - iterator) < std::abs(target - (iterator - increment)) ?
-                              iterator  :                    iterator - increment;
-        break;
-      }
+    // Grid nodes around target: node k and the next one,
+    // the last cell is cut by the right boundary
+    double lower = left;
+    double upper = bound;
+    if (increment > 0) {
+      const double k = std::floor((target - left) / increment);
+      lower = gridNode(left, increment, k);
+      upper = gridNode(left, increment, k + 1);
+      if (lower > bound)
+        lower = bound;
+      if (upper > bound)
+        upper = bound;
     }
-  }
 
-  nn = IVector::createVector(compDim, neighborVector.data());
-  if (nn == NULL)
-    LOG_RET("Failed to create IVector nn", ERR_ANY_OTHER);
+    // Ties go to the lower node
+    result = neighbor->setCoord(coord,
+        std::abs(target - upper) < std::abs(target - lower) ? upper : lower);
+    if (result != ERR_OK)
+      LOG_RET("Failed to set current dimension neighbor: " + std::to_string(coord), ERR_ANY_OTHER);
+  }
 
+  nn = neighbor.take();
   return ERR_OK;
 }
 
@@ -833,10 +900,8 @@ int Compact_C::getNearestNeighbor(const IVector* vec, IVector*& nn) const
     // We should continue to search for containing nearest
     // instead of wiping non containing
     if (contains) {
-      QScopedPointer<IVector> diff(IVector::subtract(vec, for_nearest.data()));
-
       double distance;
-      result = diff->norm(IVector::NORM_1, distance);
+      result = vec->distance(for_nearest.data(), IVector::NORM_1, distance);
       if (result != ERR_OK)
         LOG_RET("Failed to get distance btw vecotors", ERR_ANY_OTHER);
 
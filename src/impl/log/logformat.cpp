@@ -0,0 +1,89 @@
+#include "logformat.h"
+
+#include "ILog.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Splits packed arguments into their text, stops at malformed one
+  void unpack(std::vector<std::string>& values, const char* args, size_t length)
+  {
+    size_t pos = 0;
+    while (pos < length) {
+      const int type = static_cast<unsigned char>(args[pos++]);
+      char buffer[32];
+
+      if (type == ILog::ARG_STRING) {
+        unsigned short size;
+        if (length - pos < sizeof(size))
+          return;
+        std::memcpy(&size, args + pos, sizeof(size));
+        pos += sizeof(size);
+        if (length - pos < size)
+          return;
+        values.push_back(std::string(args + pos, size));
+        pos += size;
+        continue;
+      }
+
+      if (length - pos < 8)
+        return;
+      switch (type) {
+      case ILog::ARG_INT: {
+        long long value;
+        std::memcpy(&value, args + pos, sizeof(value));
+        std::snprintf(buffer, sizeof(buffer), "%lld", value);
+        break;
+      }
+      case ILog::ARG_UINT: {
+        unsigned long long value;
+        std::memcpy(&value, args + pos, sizeof(value));
+        std::snprintf(buffer, sizeof(buffer), "%llu", value);
+        break;
+      }
+      case ILog::ARG_DOUBLE: {
+        double value;
+        std::memcpy(&value, args + pos, sizeof(value));
+        std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+        break;
+      }
+      default:
+        return;
+      }
+      values.push_back(buffer);
+      pos += 8;
+    }
+  }
+}
+
+void logformat::appendMessage(std::string& out, const char* format, const char* args, size_t length)
+{
+  std::vector<std::string> values;
+  unpack(values, args, length);
+
+  for (const char* c = format; *c; ++c) {
+    if (*c != '%') {
+      out += *c;
+    } else if (c[1] == '%') {
+      out += '%';
+      ++c;
+    } else if (c[1] >= '1' && c[1] <= '9' && static_cast<size_t>(c[1] - '1') < values.size()) {
+      out += values[c[1] - '1'];
+      ++c;
+    } else {
+      out += *c;
+    }
+  }
+}
+
+int logformat::msecsOfDay(long long time, long long sessionTime, int sessionMsecs)
+{
+  static const long long day = 24LL * 60 * 60 * 1000;
+
+  long long msecs = (sessionMsecs + (time - sessionTime) / 1000000) % day;
+  if (msecs < 0)
+    msecs += day;
+  return static_cast<int>(msecs);
+}
@@ -0,0 +1,38 @@
+#ifndef LOG_LOGFORMAT_H_
+#define LOG_LOGFORMAT_H_
+
+#include <cstddef>
+#include <string>
+
+/// \brief Binary log file layout, shared by ILog and LogDecode
+///
+/// Every session starts with magic, steady clock time in nanoseconds and
+/// time of day in milliseconds taken at the same moment. Records follow,
+/// each is 4 bytes of payload size, 1 byte of RecordKind and payload:
+///   RECORD_FORMAT  - 4 bytes id, location, '\0', format
+///   RECORD_TEXT    - 8 bytes time, text
+///   RECORD_MESSAGE - 4 bytes id, 8 bytes time, arguments packed by LogArgs
+/// Numbers are in byte order of writing machine. Format of id is written
+/// before first message using it.
+namespace logformat {
+  static const char magic[8] = { 'I', 'L', 'O', 'G', 'B', 'I', 'N', '1' };
+  static const size_t sessionSize = sizeof(magic) + 8 + 4;
+  static const size_t recordHeadSize = 4 + 1;
+
+  enum RecordKind
+  {
+    RECORD_FORMAT = 1,
+    RECORD_TEXT,
+    RECORD_MESSAGE
+  };
+
+  /// \brief Appends format with "%1".."%9" replaced by packed arguments
+  ///
+  /// Placeholders without argument are kept, "%%" gives "%".
+  void appendMessage(std::string& out, const char* format, const char* args, size_t length);
+
+  /// \brief Time of day in milliseconds of steady clock time
+  int msecsOfDay(long long time, long long sessionTime, int sessionMsecs);
+}
+
+#endif // LOG_LOGFORMAT_H_
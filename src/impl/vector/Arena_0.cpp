@@ -0,0 +1,198 @@
+#include <IVectorArena.h>
+#include <logging.h>
+#include <error.h>
+#include <new>
+#include <QVector>
+#include "Vector_0.h"
+#include "storage.h"
+
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Vector placed into arena slab
+  ///
+  /// Neither object nor coordinates are freed on delete,
+  /// slab memory is reused after IVectorArena::reset().
+  class Vector_A : public Vector_0 {
+  public:
+    Vector_A(unsigned int size, double* vals)
+      : Vector_0(size, vals, false)
+    {  }
+
+    static void operator delete(void* ptr)
+    {
+      Q_UNUSED(ptr);
+    }
+  };
+
+  /// \brief Bump pointer IVectorArena implementation
+  ///
+  /// Slabs are kept after reset(), so steady state iterations
+  /// do not call global allocator at all.
+  class Arena_0 : public IVectorArena {
+  /// \brief IVectorArena methods impl
+  public:
+    int getId() const;
+
+    IVector* createVector(unsigned int size, double const* vals);
+    IVector* clone(IVector const* const vector);
+
+    size_t checkpoint() const;
+    int reset(size_t checkpoint);
+
+  /// \brief Internal methods
+  public:
+    Arena_0();
+    ~Arena_0();
+
+  private:
+    void* allocate(size_t bytes);
+
+  /// \brief Internal variables
+  private:
+    struct Slab
+    {
+      char*  data;     // block of storage::allocate()
+      size_t base;     // position of data in arena
+      size_t capacity;
+    };
+
+    /// \brief Slabs in order of positions
+    ///
+    /// m_slabs[i + 1].base == m_slabs[i].base + m_slabs[i].capacity
+    QVector<Slab> m_slabs;
+
+    /// \brief Slab allocations go to, -1 if arena is empty
+    int    m_current;
+    size_t m_offset;
+  };
+
+  /// \brief Slab size for allocations that are smaller
+  static const size_t defaultSlabSize = 256 * 1024;
+} /* PIMPL_NAMESPACE */
+
+/* ---- IVectorArena factory methods ---- */
+
+IVectorArena* IVectorArena::getThreadArena()
+{
+  static thread_local Arena_0 arena;
+  return &arena;
+}
+
+/* ---- Arena_0 implementation ---- */
+
+int Arena_0::getId() const
+{
+  return IVectorArena::INTERFACE_0;
+}
+
+IVector* Arena_0::createVector(unsigned int size, double const* vals)
+{
+  // Coordinates go first to keep them aligned, object follows them
+  const size_t valsBytes = storage::alignUp(size * sizeof(double));
+  char* mem = static_cast<char*>(allocate(valsBytes + sizeof(Vector_A)));
+  if (!mem)
+    LOG_RET("Not enough memory", NULL);
+
+  double* valsArena = reinterpret_cast<double*>(mem);
+  for (size_t i = 0; i < size; ++i)
+    valsArena[i] = vals ? vals[i] : 0.0;
+
+  return new(mem + valsBytes) Vector_A(size, valsArena);
+}
+
+IVector* Arena_0::clone(const IVector* const vector)
+{
+  if (!vector)
+    LOG_RET("vector was NULL", NULL);
+
+  const unsigned int dim = vector->getDim();
+  double const* coords = denseCoords(vector);
+  if (coords)
+    return createVector(dim, coords);
+
+  IVector* res = createVector(dim, NULL);
+  if (!res)
+    LOG_RET("Failed to create arena vector", NULL);
+
+  for (unsigned int i = 0; i < dim; ++i) {
+    double coord;
+    if (vector->getCoord(i, coord) != ERR_OK || res->setCoord(i, coord) != ERR_OK)
+      LOG_RET("Failed to copy coordinate: " + std::to_string(i), NULL);
+  }
+
+  return res;
+}
+
+size_t Arena_0::checkpoint() const
+{
+  if (m_current < 0)
+    return 0;
+
+  return m_slabs[m_current].base + m_offset;
+}
+
+int Arena_0::reset(size_t checkpoint)
+{
+  if (checkpoint > this->checkpoint())
+    LOG_RET("Checkpoint is ahead of arena", ERR_WRONG_ARG);
+
+  if (m_current < 0)
+    return ERR_OK;
+
+  while (m_current > 0 && m_slabs[m_current].base > checkpoint)
+    --m_current;
+
+  m_offset = checkpoint - m_slabs[m_current].base;
+  return ERR_OK;
+}
+
+void* Arena_0::allocate(size_t bytes)
+{
+  bytes = storage::alignUp(bytes);
+
+  if (m_current >= 0 && m_offset + bytes <= m_slabs[m_current].capacity) {
+    void* res = m_slabs[m_current].data + m_offset;
+    m_offset += bytes;
+    return res;
+  }
+
+  // Reuse next slab kept from before reset()
+  if (m_current + 1 < m_slabs.size() && m_slabs[m_current + 1].capacity >= bytes) {
+    ++m_current;
+    m_offset = bytes;
+    return m_slabs[m_current].data;
+  }
+
+  // Slabs behind current are too small for request, replace them
+  while (m_slabs.size() > m_current + 1) {
+    storage::release(m_slabs.last().data);
+    m_slabs.remove(m_slabs.size() - 1);
+  }
+
+  Slab slab;
+  slab.capacity = bytes > defaultSlabSize ? bytes : defaultSlabSize;
+  slab.data = static_cast<char*>(storage::allocate(slab.capacity));
+  if (!slab.data)
+    LOG_RET("Failed to allocate arena slab", NULL);
+
+  slab.base = m_current < 0 ?
+        0 : m_slabs[m_current].base + m_slabs[m_current].capacity;
+
+  m_slabs.append(slab);
+  ++m_current;
+  m_offset = bytes;
+  return slab.data;
+}
+
+Arena_0::Arena_0()
+  : m_slabs(),
+    m_current(-1),
+    m_offset(0)
+{  }
+
+Arena_0::~Arena_0()
+{
+  for (int i = 0; i < m_slabs.size(); ++i)
+    storage::release(m_slabs[i].data);
+}
@@ -0,0 +1,372 @@
+#include <IVectorBatch.h>
+#include <IVector.h>
+#include <logging.h>
+#include <error.h>
+#include <cmath>
+#include <new>
+#include <string>
+#include "blas.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "storage.h"
+#include "Vector_0.h"
+
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief IVectorBatch over one storage block
+  ///
+  /// Storage is rows of ld coordinates, a row is a vector in row-major
+  /// layout and a coordinate of all vectors in SoA layout. ld is padded
+  /// to a cache line, padding belongs to batch, so whole-block kernels
+  /// may run over it.
+  class Batch_0 : public IVectorBatch {
+  /// \brief IVectorBatch methods impl
+  public:
+    int getId() const;
+
+    /*operations*/
+    int norms(IVector::NormType type, double* res) const;
+    int dotProduct(IVector const* const x, double* res) const;
+    int axpy(double alpha, IVector const* const x);
+    int axpy(double alpha, IVectorBatch const* const x);
+    int multiplyByScalar(double scalar);
+
+    /*utils*/
+    unsigned int getCount() const;
+    unsigned int getDim() const;
+    Layout getLayout() const;
+    IVector* getVector(unsigned int index);
+    int setVector(unsigned int index, IVector const* const vector);
+    int setCoord(unsigned int index, unsigned int coord, double elem);
+    int getCoord(unsigned int index, unsigned int coord, double& elem) const;
+    int getElemsPtr(unsigned int& ld, double const*& elems) const;
+    int getMutableElemsPtr(unsigned int& ld, double*& elems);
+    IVectorBatch* clone() const;
+
+  /// \brief Internal methods
+  public:
+    /// \returns batch of zero vectors or NULL
+    static Batch_0* create(unsigned int count, unsigned int dim, Layout layout);
+    ~Batch_0();
+
+  private:
+    Batch_0(unsigned int count, unsigned int dim, Layout layout, unsigned int ld, double* vals);
+
+    /// \brief Rows of storage, ld coordinates each
+    unsigned int rows() const { return m_layout == LAYOUT_ROW_MAJOR ? m_count : m_dim; }
+    size_t size() const { return static_cast<size_t>(rows()) * m_ld; }
+
+    /// \brief Position of coordinate of vector in storage
+    size_t at(unsigned int index, unsigned int coord) const
+    {
+      return m_layout == LAYOUT_ROW_MAJOR ?
+            static_cast<size_t>(index) * m_ld + coord :
+            static_cast<size_t>(coord) * m_ld + index;
+    }
+
+  /// \brief Internal variables
+  private:
+    double*      m_vals;
+    unsigned int m_count;
+    unsigned int m_dim;
+    unsigned int m_ld;
+    Layout       m_layout;
+  };
+
+  /// \brief Coordinates in cache line
+  static const unsigned int lineCoords = storage::cacheLine / sizeof(double);
+} /* PIMPL_NAMESPACE */
+
+/* ---- IVectorBatch factory methods ---- */
+
+IVectorBatch* IVectorBatch::createBatch(unsigned int count, unsigned int dim, double const* vals,
+                                        Layout layout)
+{
+  if (layout != LAYOUT_ROW_MAJOR && layout != LAYOUT_SOA)
+    LOG_RET("Unknown layout", NULL);
+
+  Batch_0* batch = Batch_0::create(count, dim, layout);
+  if (!batch)
+    LOG_RET("Failed to create batch", NULL);
+
+  if (vals) {
+    double* elems;
+    unsigned int ld;
+    batch->getMutableElemsPtr(ld, elems);
+    for (unsigned int i = 0; i < count; ++i)
+      for (unsigned int j = 0; j < dim; ++j) {
+        const double elem = vals[static_cast<size_t>(i) * dim + j];
+        if (layout == LAYOUT_ROW_MAJOR)
+          elems[static_cast<size_t>(i) * ld + j] = elem;
+        else
+          elems[static_cast<size_t>(j) * ld + i] = elem;
+      }
+  }
+  return batch;
+}
+
+/* ---- Batch_0 implementation ---- */
+
+Batch_0* Batch_0::create(unsigned int count, unsigned int dim, Layout layout)
+{
+  const unsigned int cols = layout == LAYOUT_ROW_MAJOR ? dim : count;
+  const unsigned int rows = layout == LAYOUT_ROW_MAJOR ? count : dim;
+  const unsigned int ld = (cols + lineCoords - 1) / lineCoords * lineCoords;
+  const size_t size = static_cast<size_t>(rows) * ld;
+
+  double* vals = static_cast<double*>(storage::allocate(size * sizeof(double)));
+  if (!vals)
+    LOG_RET("Not enough memory", NULL);
+  for (size_t i = 0; i < size; ++i)
+    vals[i] = 0;
+
+  Batch_0* batch = new(std::nothrow) Batch_0(count, dim, layout, ld, vals);
+  if (!batch) {
+    storage::release(vals);
+    LOG_RET("Not enough memory", NULL);
+  }
+  return batch;
+}
+
+Batch_0::Batch_0(unsigned int count, unsigned int dim, Layout layout, unsigned int ld, double* vals)
+  : m_vals(vals),
+    m_count(count),
+    m_dim(dim),
+    m_ld(ld),
+    m_layout(layout)
+{  }
+
+Batch_0::~Batch_0()
+{
+  storage::release(m_vals);
+}
+
+int Batch_0::getId() const
+{
+  return IVectorBatch::INTERFACE_0;
+}
+
+int Batch_0::norms(IVector::NormType type, double* res) const
+{
+  if (!res)
+    LOG_RET("res was NULL", ERR_WRONG_ARG);
+  if (type != IVector::NORM_1 && type != IVector::NORM_2 && type != IVector::NORM_INF)
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+
+  const kernels::Table& k = kernels::table();
+  if (m_layout == LAYOUT_ROW_MAJOR) {
+    for (unsigned int i = 0; i < m_count; ++i) {
+      double const* row = m_vals + static_cast<size_t>(i) * m_ld;
+      res[i] = type == IVector::NORM_1 ? k.norm1(row, m_dim) :
+               type == IVector::NORM_2 ? sqrt(k.norm2sq(row, m_dim)) : k.normInf(row, m_dim);
+    }
+    return ERR_OK;
+  }
+
+  // Norms of all vectors grow together coordinate by coordinate
+  double* abs = NULL;
+  if (type != IVector::NORM_2) {
+    abs = new(std::nothrow) double[m_count ? m_count : 1];
+    if (!abs)
+      LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+  }
+
+  for (unsigned int i = 0; i < m_count; ++i)
+    res[i] = 0;
+  for (unsigned int j = 0; j < m_dim; ++j) {
+    double const* coords = m_vals + static_cast<size_t>(j) * m_ld;
+    if (type == IVector::NORM_2) {
+      k.fma(res, coords, coords, m_count);
+      continue;
+    }
+    k.absolute(abs, coords, m_count);
+    if (type == IVector::NORM_1)
+      k.add(res, res, abs, m_count);
+    else
+      k.maximum(res, abs, res, m_count); // NaN coordinates are skipped as in IVector::norm()
+  }
+
+  if (type == IVector::NORM_2)
+    for (unsigned int i = 0; i < m_count; ++i)
+      res[i] = sqrt(res[i]);
+  delete[] abs;
+  return ERR_OK;
+}
+
+int Batch_0::dotProduct(IVector const* const x, double* res) const
+{
+  if (!x || !res)
+    LOG_RET("NULL pointer", ERR_WRONG_ARG);
+  if (x->getDim() != m_dim)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  VectorOperand xOperand(x);
+  if (xOperand.result() != ERR_OK)
+    LOG_RET("Failed to get x coordinates", xOperand.result());
+
+  // Batch is count x dim matrix in row-major layout and its transpose in SoA
+  if (m_layout == LAYOUT_ROW_MAJOR)
+    blas::gemv(m_count, m_dim, 1, m_vals, m_ld, xOperand.coords(), 0, res);
+  else
+    blas::gemvT(m_dim, m_count, 1, m_vals, m_ld, xOperand.coords(), 0, res);
+  return ERR_OK;
+}
+
+int Batch_0::axpy(double alpha, IVector const* const x)
+{
+  if (!x)
+    LOG_RET("x was NULL", ERR_WRONG_ARG);
+  if (x->getDim() != m_dim)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  VectorOperand xOperand(x);
+  if (xOperand.result() != ERR_OK)
+    LOG_RET("Failed to get x coordinates", xOperand.result());
+
+  // x may be a vector of this batch, it must not change under the loop then
+  double const* xCoords = xOperand.coords();
+  double* xCopy = NULL;
+  if (xCoords >= m_vals && xCoords < m_vals + size()) {
+    xCopy = new(std::nothrow) double[m_dim];
+    if (!xCopy)
+      LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+    for (unsigned int j = 0; j < m_dim; ++j)
+      xCopy[j] = xCoords[j];
+    xCoords = xCopy;
+  }
+
+  if (m_layout == LAYOUT_ROW_MAJOR) {
+    const kernels::Table& k = kernels::table();
+    for (unsigned int i = 0; i < m_count; ++i)
+      k.axpy(m_vals + static_cast<size_t>(i) * m_ld, alpha, xCoords, m_dim);
+  } else {
+    for (unsigned int j = 0; j < m_dim; ++j) {
+      double* coords = m_vals + static_cast<size_t>(j) * m_ld;
+      const double shift = alpha * xCoords[j];
+      for (unsigned int i = 0; i < m_count; ++i)
+        coords[i] += shift;
+    }
+  }
+  delete[] xCopy;
+  return ERR_OK;
+}
+
+int Batch_0::axpy(double alpha, IVectorBatch const* const x)
+{
+  if (!x)
+    LOG_RET("x was NULL", ERR_WRONG_ARG);
+  if (x->getCount() != m_count || x->getDim() != m_dim)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  unsigned int ld;
+  double const* elems;
+  if (x->getElemsPtr(ld, elems) != ERR_OK)
+    LOG_RET("Failed to get x coordinates", ERR_ANY_OTHER);
+
+  // Same layout and padding make one kernel over both blocks
+  if (x->getLayout() == m_layout && ld == m_ld) {
+    parallel::tableFor(size()).axpy(m_vals, alpha, elems, size());
+    return ERR_OK;
+  }
+
+  for (unsigned int i = 0; i < m_count; ++i)
+    for (unsigned int j = 0; j < m_dim; ++j) {
+      const size_t from = x->getLayout() == LAYOUT_ROW_MAJOR ?
+            static_cast<size_t>(i) * ld + j : static_cast<size_t>(j) * ld + i;
+      m_vals[at(i, j)] += alpha * elems[from];
+    }
+  return ERR_OK;
+}
+
+int Batch_0::multiplyByScalar(double scalar)
+{
+  parallel::tableFor(size()).scale(m_vals, m_vals, scalar, size());
+  return ERR_OK;
+}
+
+unsigned int Batch_0::getCount() const
+{
+  return m_count;
+}
+
+unsigned int Batch_0::getDim() const
+{
+  return m_dim;
+}
+
+IVectorBatch::Layout Batch_0::getLayout() const
+{
+  return m_layout;
+}
+
+IVector* Batch_0::getVector(unsigned int index)
+{
+  if (index >= m_count)
+    LOG_RET("Index out of range: " + std::to_string(index), NULL);
+
+  if (m_layout == LAYOUT_ROW_MAJOR)
+    return IVector::createView(m_dim, m_vals + static_cast<size_t>(index) * m_ld);
+  return createStridedView(m_dim, m_vals + index, m_ld);
+}
+
+int Batch_0::setVector(unsigned int index, IVector const* const vector)
+{
+  if (index >= m_count)
+    LOG_RET("Index out of range: " + std::to_string(index), ERR_OUT_OF_RANGE);
+  if (!vector)
+    LOG_RET("vector was NULL", ERR_WRONG_ARG);
+  if (vector->getDim() != m_dim)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  VectorOperand operand(vector);
+  if (operand.result() != ERR_OK)
+    LOG_RET("Failed to get vector coordinates", operand.result());
+
+  for (unsigned int j = 0; j < m_dim; ++j)
+    m_vals[at(index, j)] = operand.coords()[j];
+  return ERR_OK;
+}
+
+int Batch_0::setCoord(unsigned int index, unsigned int coord, double elem)
+{
+  if (index >= m_count || coord >= m_dim)
+    LOG_RET("Index out of range: " + std::to_string(index) + ", " + std::to_string(coord), ERR_OUT_OF_RANGE);
+
+  m_vals[at(index, coord)] = elem;
+  return ERR_OK;
+}
+
+int Batch_0::getCoord(unsigned int index, unsigned int coord, double& elem) const
+{
+  if (index >= m_count || coord >= m_dim)
+    LOG_RET("Index out of range: " + std::to_string(index) + ", " + std::to_string(coord), ERR_OUT_OF_RANGE);
+
+  elem = m_vals[at(index, coord)];
+  return ERR_OK;
+}
+
+int Batch_0::getElemsPtr(unsigned int& ld, double const*& elems) const
+{
+  ld = m_ld;
+  elems = m_vals;
+  return ERR_OK;
+}
+
+int Batch_0::getMutableElemsPtr(unsigned int& ld, double*& elems)
+{
+  ld = m_ld;
+  elems = m_vals;
+  return ERR_OK;
+}
+
+IVectorBatch* Batch_0::clone() const
+{
+  Batch_0* batch = create(m_count, m_dim, m_layout);
+  if (!batch)
+    LOG_RET("Failed to create batch", NULL);
+
+  for (size_t i = 0; i < size(); ++i)
+    batch->m_vals[i] = m_vals[i];
+  return batch;
+}
@@ -0,0 +1,468 @@
+#include <IMatrix.h>
+#include <IVector.h>
+#include <logging.h>
+#include <error.h>
+#include <new>
+#include <string>
+#include "blas.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "storage.h"
+#include "Vector_0.h"
+
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Row-major IMatrix implementation
+  ///
+  /// Storage is one block of rows * cols coordinates, so whole-matrix
+  /// operations are single vector kernels and products go to blas.
+  class Matrix_0 : public IMatrix {
+  /// \brief IMatrix methods impl
+  public:
+    int getId() const;
+
+    /*operations*/
+    int add(IMatrix const* const right);
+    int subtract(IMatrix const* const right);
+    int multiplyByScalar(double scalar);
+    int multiply(double alpha, IVector const* const x, double beta, IVector* const y,
+                 Transpose trans) const;
+    int multiply(double alpha, IMatrix const* const a, Transpose transA,
+                 IMatrix const* const b, Transpose transB, double beta);
+    int rank1Update(double alpha, IVector const* const x, IVector const* const y);
+    int bilinearForm(IVector const* const x, IVector const* const y, double& res) const;
+
+    /*utils*/
+    unsigned int getRows() const;
+    unsigned int getCols() const;
+    int setElem(unsigned int row, unsigned int col, double elem);
+    int getElem(unsigned int row, unsigned int col, double& elem) const;
+    IVector* getRow(unsigned int row);
+    int getElemsPtr(unsigned int& rows, unsigned int& cols, double const*& elems) const;
+    int getMutableElemsPtr(unsigned int& rows, unsigned int& cols, double*& elems);
+    IMatrix* clone() const;
+
+  /// \brief Internal methods
+  public:
+    static Matrix_0* create(unsigned int rows, unsigned int cols);
+    Matrix_0(unsigned int rows, unsigned int cols, double* vals, bool ownsVals);
+    ~Matrix_0();
+
+  private:
+    size_t size() const { return static_cast<size_t>(m_rows) * m_cols; }
+
+  /// \brief Internal variables
+  private:
+    double*      m_vals;
+    unsigned int m_rows;
+    unsigned int m_cols;
+    bool         m_ownsVals;
+  };
+
+  /// \brief Coordinates of IMatrix operand, copied if it has no storage
+  class MatrixOperand {
+  public:
+    explicit MatrixOperand(IMatrix const* const matrix)
+      : m_elems(NULL),
+        m_copy(NULL),
+        m_result(ERR_OK)
+    {
+      unsigned int rows, cols;
+      if (matrix->getElemsPtr(rows, cols, m_elems) == ERR_OK)
+        return;
+
+      rows = matrix->getRows();
+      cols = matrix->getCols();
+      const size_t size = static_cast<size_t>(rows) * cols;
+      m_copy = new(std::nothrow) double[size ? size : 1];
+      if (!m_copy) {
+        m_result = ERR_MEMORY_ALLOCATION;
+        return;
+      }
+      for (unsigned int i = 0; i < rows && m_result == ERR_OK; ++i)
+        for (unsigned int j = 0; j < cols && m_result == ERR_OK; ++j)
+          m_result = matrix->getElem(i, j, m_copy[static_cast<size_t>(i) * cols + j]);
+      m_elems = m_copy;
+    }
+
+    ~MatrixOperand()
+    {
+      delete[] m_copy;
+    }
+
+    int result() const { return m_result; }
+    double const* elems() const { return m_elems; }
+
+  private:
+    double const* m_elems;
+    double*       m_copy;
+    int           m_result;
+  };
+
+  /// \brief Tile edge of transpose(), tile of both matrices fits L1
+  static const unsigned int transposeTile = 32;
+} /* PIMPL_NAMESPACE */
+
+/* ---- IMatrix factory methods ---- */
+
+IMatrix* IMatrix::createMatrix(unsigned int rows, unsigned int cols, double const* vals)
+{
+  Matrix_0* matrix = Matrix_0::create(rows, cols);
+  if (!matrix)
+    LOG_RET("Failed to create matrix", NULL);
+
+  double* elems;
+  matrix->getMutableElemsPtr(rows, cols, elems);
+  const size_t size = static_cast<size_t>(rows) * cols;
+  for (size_t i = 0; i < size; ++i)
+    elems[i] = vals ? vals[i] : 0;
+  return matrix;
+}
+
+IMatrix* IMatrix::createIdentity(unsigned int dim)
+{
+  IMatrix* matrix = createMatrix(dim, dim, NULL);
+  if (!matrix)
+    LOG_RET("Failed to create identity matrix", NULL);
+
+  for (unsigned int i = 0; i < dim; ++i)
+    matrix->setElem(i, i, 1);
+  return matrix;
+}
+
+IMatrix* IMatrix::createView(unsigned int rows, unsigned int cols, double* vals)
+{
+  if (!vals && rows > 0 && cols > 0)
+    LOG_RET("vals was NULL", NULL);
+
+  IMatrix* matrix = new(std::nothrow) Matrix_0(rows, cols, vals, false);
+  if (!matrix)
+    LOG_RET("Not enough memory", NULL);
+  return matrix;
+}
+
+/* ---- IMatrix static operations ---- */
+
+IMatrix* IMatrix::multiply(IMatrix const* const left, Transpose transLeft,
+                           IMatrix const* const right, Transpose transRight)
+{
+  if (!left || !right)
+    LOG_RET("Operand was NULL", NULL);
+
+  const unsigned int rows = transLeft == TRANSPOSE ? left->getCols() : left->getRows();
+  const unsigned int cols = transRight == TRANSPOSE ? right->getRows() : right->getCols();
+  IMatrix* res = createMatrix(rows, cols, NULL);
+  if (!res)
+    LOG_RET("Failed to create product matrix", NULL);
+
+  if (res->multiply(1, left, transLeft, right, transRight, 0) != ERR_OK) {
+    delete res;
+    LOG_RET("Failed to multiply matrices", NULL);
+  }
+  return res;
+}
+
+IMatrix* IMatrix::transpose(IMatrix const* const matrix)
+{
+  if (!matrix)
+    LOG_RET("matrix was NULL", NULL);
+
+  MatrixOperand src(matrix);
+  if (src.result() != ERR_OK)
+    LOG_RET("Failed to get matrix elements", NULL);
+
+  const unsigned int rows = matrix->getRows();
+  const unsigned int cols = matrix->getCols();
+  Matrix_0* res = Matrix_0::create(cols, rows);
+  if (!res)
+    LOG_RET("Failed to create transposed matrix", NULL);
+
+  unsigned int resRows, resCols;
+  double* dst;
+  res->getMutableElemsPtr(resRows, resCols, dst);
+
+  // Tile by tile, so neither rows nor columns are walked across whole matrix
+  for (unsigned int i0 = 0; i0 < rows; i0 += transposeTile)
+    for (unsigned int j0 = 0; j0 < cols; j0 += transposeTile) {
+      const unsigned int iEnd = rows - i0 < transposeTile ? rows : i0 + transposeTile;
+      const unsigned int jEnd = cols - j0 < transposeTile ? cols : j0 + transposeTile;
+      for (unsigned int i = i0; i < iEnd; ++i)
+        for (unsigned int j = j0; j < jEnd; ++j)
+          dst[static_cast<size_t>(j) * rows + i] = src.elems()[static_cast<size_t>(i) * cols + j];
+    }
+  return res;
+}
+
+/* ---- Matrix_0 implementation ---- */
+
+Matrix_0* Matrix_0::create(unsigned int rows, unsigned int cols)
+{
+  const size_t size = static_cast<size_t>(rows) * cols;
+  double* vals = static_cast<double*>(storage::allocate(size * sizeof(double)));
+  if (!vals)
+    LOG_RET("Not enough memory", NULL);
+
+  Matrix_0* matrix = new(std::nothrow) Matrix_0(rows, cols, vals, true);
+  if (!matrix) {
+    storage::release(vals);
+    LOG_RET("Not enough memory", NULL);
+  }
+  return matrix;
+}
+
+Matrix_0::Matrix_0(unsigned int rows, unsigned int cols, double* vals, bool ownsVals)
+  : m_vals(vals),
+    m_rows(rows),
+    m_cols(cols),
+    m_ownsVals(ownsVals)
+{  }
+
+Matrix_0::~Matrix_0()
+{
+  if (m_ownsVals)
+    storage::release(m_vals);
+}
+
+int Matrix_0::getId() const
+{
+  return IMatrix::INTERFACE_0;
+}
+
+int Matrix_0::add(IMatrix const* const right)
+{
+  if (!right)
+    LOG_RET("right was NULL", ERR_WRONG_ARG);
+  if (right->getRows() != m_rows || right->getCols() != m_cols)
+    LOG_RET("Matrices dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  MatrixOperand r(right);
+  if (r.result() != ERR_OK)
+    LOG_RET("Failed to get right elements", r.result());
+
+  parallel::tableFor(size()).add(m_vals, m_vals, r.elems(), size());
+  return ERR_OK;
+}
+
+int Matrix_0::subtract(IMatrix const* const right)
+{
+  if (!right)
+    LOG_RET("right was NULL", ERR_WRONG_ARG);
+  if (right->getRows() != m_rows || right->getCols() != m_cols)
+    LOG_RET("Matrices dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  MatrixOperand r(right);
+  if (r.result() != ERR_OK)
+    LOG_RET("Failed to get right elements", r.result());
+
+  parallel::tableFor(size()).subtract(m_vals, m_vals, r.elems(), size());
+  return ERR_OK;
+}
+
+int Matrix_0::multiplyByScalar(double scalar)
+{
+  parallel::tableFor(size()).scale(m_vals, m_vals, scalar, size());
+  return ERR_OK;
+}
+
+int Matrix_0::multiply(double alpha, IVector const* const x, double beta, IVector* const y,
+                       Transpose trans) const
+{
+  if (!x || !y)
+    LOG_RET("Vector was NULL", ERR_WRONG_ARG);
+  if (trans != NO_TRANSPOSE && trans != TRANSPOSE)
+    LOG_RET("Unknown transpose", ERR_WRONG_ARG);
+
+  const unsigned int xDim = trans == TRANSPOSE ? m_rows : m_cols;
+  const unsigned int yDim = trans == TRANSPOSE ? m_cols : m_rows;
+  if (x->getDim() != xDim || y->getDim() != yDim)
+    LOG_RET("Vectors dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  // x == y is read through its clone, storage of clone outlives writes to y
+  IVector* xClone = NULL;
+  if (x == y) {
+    xClone = x->clone();
+    if (!xClone)
+      LOG_RET("Failed to clone x", ERR_MEMORY_ALLOCATION);
+  }
+
+  VectorOperand xOperand(xClone ? xClone : x);
+  int result = xOperand.result();
+  if (result != ERR_OK) {
+    delete xClone;
+    LOG_RET("Failed to get x coordinates", result);
+  }
+
+  unsigned int dim;
+  double* yCoords = NULL;
+  double* yCopy = NULL;
+  if (y->getUpdateCoordsPtr(dim, yCoords) != ERR_OK) {
+    // Without writable storage y is computed aside and set at once
+    yCopy = new(std::nothrow) double[yDim ? yDim : 1];
+    if (!yCopy) {
+      delete xClone;
+      LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+    }
+    for (unsigned int i = 0; i < yDim && beta != 0 && result == ERR_OK; ++i)
+      result = y->getCoord(i, yCopy[i]);
+    yCoords = yCopy;
+  }
+
+  if (result == ERR_OK) {
+    if (trans == TRANSPOSE)
+      blas::gemvT(m_rows, m_cols, alpha, m_vals, m_cols, xOperand.coords(), beta, yCoords);
+    else
+      blas::gemv(m_rows, m_cols, alpha, m_vals, m_cols, xOperand.coords(), beta, yCoords);
+
+    if (yCopy)
+      result = y->setAllCoords(yDim, yCopy);
+  }
+
+  delete xClone;
+  delete[] yCopy;
+  if (result != ERR_OK)
+    LOG_RET("Failed to access y coordinates", result);
+  return ERR_OK;
+}
+
+int Matrix_0::multiply(double alpha, IMatrix const* const a, Transpose transA,
+                       IMatrix const* const b, Transpose transB, double beta)
+{
+  if (!a || !b)
+    LOG_RET("Operand was NULL", ERR_WRONG_ARG);
+  if ((transA != NO_TRANSPOSE && transA != TRANSPOSE) ||
+      (transB != NO_TRANSPOSE && transB != TRANSPOSE))
+    LOG_RET("Unknown transpose", ERR_WRONG_ARG);
+
+  const bool ta = transA == TRANSPOSE;
+  const bool tb = transB == TRANSPOSE;
+  const unsigned int m = ta ? a->getCols() : a->getRows();
+  const unsigned int k = ta ? a->getRows() : a->getCols();
+  const unsigned int n = tb ? b->getRows() : b->getCols();
+  if (m != m_rows || n != m_cols || k != (tb ? b->getCols() : b->getRows()))
+    LOG_RET("Matrices dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  MatrixOperand aOperand(a);
+  MatrixOperand bOperand(b);
+  if (aOperand.result() != ERR_OK || bOperand.result() != ERR_OK)
+    LOG_RET("Failed to get operand elements", ERR_ANY_OTHER);
+
+  // Product overwrites this while reading it, so it is made aside
+  double* dst = m_vals;
+  if (a == this || b == this) {
+    dst = new(std::nothrow) double[size() ? size() : 1];
+    if (!dst)
+      LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+    for (size_t i = 0; i < size() && beta != 0; ++i)
+      dst[i] = m_vals[i];
+  }
+
+  const bool done = blas::gemm(ta, tb, m, n, k,
+                               alpha, aOperand.elems(), ta ? m : k, bOperand.elems(), tb ? k : n,
+                               beta, dst, n);
+  if (dst != m_vals) {
+    if (done)
+      for (size_t i = 0; i < size(); ++i)
+        m_vals[i] = dst[i];
+    delete[] dst;
+  }
+  if (!done)
+    LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+  return ERR_OK;
+}
+
+int Matrix_0::rank1Update(double alpha, IVector const* const x, IVector const* const y)
+{
+  if (!x || !y)
+    LOG_RET("Vector was NULL", ERR_WRONG_ARG);
+  if (x->getDim() != m_rows || y->getDim() != m_cols)
+    LOG_RET("Vectors dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  VectorOperand xOperand(x);
+  VectorOperand yOperand(y);
+  if (xOperand.result() != ERR_OK || yOperand.result() != ERR_OK)
+    LOG_RET("Failed to get vector coordinates", ERR_ANY_OTHER);
+
+  blas::ger(m_rows, m_cols, alpha, xOperand.coords(), yOperand.coords(), m_vals, m_cols);
+  return ERR_OK;
+}
+
+int Matrix_0::bilinearForm(IVector const* const x, IVector const* const y, double& res) const
+{
+  if (!x || !y)
+    LOG_RET("Vector was NULL", ERR_WRONG_ARG);
+  if (x->getDim() != m_rows || y->getDim() != m_cols)
+    LOG_RET("Vectors dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+
+  VectorOperand xOperand(x);
+  VectorOperand yOperand(y);
+  if (xOperand.result() != ERR_OK || yOperand.result() != ERR_OK)
+    LOG_RET("Failed to get vector coordinates", ERR_ANY_OTHER);
+
+  double* product = new(std::nothrow) double[m_rows ? m_rows : 1];
+  if (!product)
+    LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+
+  blas::gemv(m_rows, m_cols, 1, m_vals, m_cols, yOperand.coords(), 0, product);
+  res = parallel::tableFor(m_rows).dot(xOperand.coords(), product, m_rows);
+
+  delete[] product;
+  return ERR_OK;
+}
+
+unsigned int Matrix_0::getRows() const
+{
+  return m_rows;
+}
+
+unsigned int Matrix_0::getCols() const
+{
+  return m_cols;
+}
+
+int Matrix_0::setElem(unsigned int row, unsigned int col, double elem)
+{
+  if (row >= m_rows || col >= m_cols)
+    LOG_RET("Index out of range: " + std::to_string(row) + ", " + std::to_string(col), ERR_OUT_OF_RANGE);
+
+  m_vals[static_cast<size_t>(row) * m_cols + col] = elem;
+  return ERR_OK;
+}
+
+int Matrix_0::getElem(unsigned int row, unsigned int col, double& elem) const
+{
+  if (row >= m_rows || col >= m_cols)
+    LOG_RET("Index out of range: " + std::to_string(row) + ", " + std::to_string(col), ERR_OUT_OF_RANGE);
+
+  elem = m_vals[static_cast<size_t>(row) * m_cols + col];
+  return ERR_OK;
+}
+
+IVector* Matrix_0::getRow(unsigned int row)
+{
+  if (row >= m_rows)
+    LOG_RET("Row out of range: " + std::to_string(row), NULL);
+
+  return IVector::createView(m_cols, m_vals + static_cast<size_t>(row) * m_cols);
+}
+
+int Matrix_0::getElemsPtr(unsigned int& rows, unsigned int& cols, double const*& elems) const
+{
+  rows = m_rows;
+  cols = m_cols;
+  elems = m_vals;
+  return ERR_OK;
+}
+
+int Matrix_0::getMutableElemsPtr(unsigned int& rows, unsigned int& cols, double*& elems)
+{
+  rows = m_rows;
+  cols = m_cols;
+  elems = m_vals;
+  return ERR_OK;
+}
+
+IMatrix* Matrix_0::clone() const
+{
+  return IMatrix::createMatrix(m_rows, m_cols, m_vals);
+}
@@ -0,0 +1,253 @@
+#ifndef VECTOR_0_H_
+#define VECTOR_0_H_
+
+#include <IVector.h>
+#include <atomic>
+#include "kernels.h"
+#include "storage.h"
+
+/// \brief IVector implementations shared between vector library units
+namespace vector_impl {
+
+/// \brief Reference counted coordinates
+///
+/// Clones of Vector_0 share one block until either of them is changed.
+/// Reference counter is followed by coordinates in the same allocation.
+struct SharedVals
+{
+    std::atomic<int> refs;
+
+    /// \returns block with single reference or NULL
+    static SharedVals* create(unsigned int size, double const* vals);
+
+    double* vals()
+    {
+        return reinterpret_cast<double*>(reinterpret_cast<char*>(this) + header);
+    }
+
+    bool isShared() const
+    {
+        return refs.load(std::memory_order_acquire) > 1;
+    }
+
+    void retain()
+    {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release();
+
+    /// \brief Offset of coordinates keeping them on cache line
+    static const size_t header = storage::cacheLine;
+};
+
+class Vector_0: public IVector{
+public:
+
+//    enum InterfaceTypes
+//    {
+//        INTERFACE_0,
+//        DIMENSION_INTERFACE_IMPL
+//    };
+
+//    enum NormType
+//    {
+//        NORM_1,
+//        NORM_2,
+//        NORM_INF,
+//        DIMENSION_NORM
+//    };
+
+     int getId() const;
+
+    /*factories*/
+    // static IVector* createVector(unsigned int size, double const* vals);
+
+    /*operations*/
+     int add(IVector const* const right);
+     int subtract(IVector const* const right);
+     int multiplyByScalar(double scalar) ;
+     int dotProduct(IVector const* const right, double& res) const;
+     int crossProduct(IVector const* const right)
+    {
+        qt_assert("NOT IMPLEMENTED", __FILE__, __LINE__);
+        return ERR_NOT_IMPLEMENTED;
+    }
+
+    /*fused operations*/
+     int axpy(double alpha, IVector const* const x);
+     int axpby(double alpha, IVector const* const x, double beta);
+     int linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors);
+
+    /*elementwise operations*/
+     int absolute();
+     int signum();
+     int clamp(IVector const* const lower, IVector const* const upper);
+     int elementwiseMin(IVector const* const right);
+     int elementwiseMax(IVector const* const right);
+     int hadamardProduct(IVector const* const right);
+     int fusedMultiplyAdd(IVector const* const x, IVector const* const y);
+
+//    /*static operations*/
+//    static IVector* add(IVector const* const left, IVector const* const right);
+//    static IVector* subtract(IVector const* const left, IVector const* const right);
+//    static IVector* multiplyByScalar(IVector const* const left, double scalar);
+//    static IVector* crossProduct(IVector const* const left, IVector const* const right)
+//    {
+//        //qt_assert("NOT IMPLEMENTED", __FILE__, __LINE__);
+//        return static_cast<IVector*>(0);
+//    }
+
+    /*comparators*/
+     int gt(IVector const* const right, NormType type, bool& result) const ;
+     int lt(IVector const* const right, NormType type, bool& result) const ;
+     int eq(IVector const* const right, NormType type, bool& result, double precision) const;
+     int distance(IVector const* const right, NormType type, double& res) const;
+
+    /*utils*/
+     unsigned int getDim() const ;
+     int norm(NormType type, double& res) const ;
+     int norms(double& norm1, double& norm2, double& normInf) const;
+     int cacheNorms(bool enable);
+     int setCoord(unsigned int index, double elem) ;
+     int getCoord(unsigned int index, double & elem) const ;
+     int setAllCoords(unsigned int dim, double* coords) ;
+     int getCoordsPtr(unsigned int & dim, double const*& elem) const;
+     int getMutableCoordsPtr(unsigned int & dim, double*& elem);
+     int getUpdateCoordsPtr(unsigned int & dim, double*& elem);
+     IVector* clone() const ;
+
+     /*ctor*/
+      Vector_0(unsigned int size, double *vals);
+      Vector_0(unsigned int size, double *vals, bool ownsVals);
+      /// \brief Takes over one reference to shared
+      Vector_0(unsigned int size, SharedVals* shared);
+
+    /// \brief Keeps m_vals in place for views made by IVector::createSubVector,
+    /// pointers given by getMutableCoordsPtr() and IVector::createView
+    ///
+    /// Storage is made private and later clones copy it instead of sharing,
+    /// norms are not cached any more since coordinates change bypassing detach().
+    int pin();
+
+    /*dtor*/
+     ~Vector_0(){
+         if (m_shared)
+             m_shared->release();
+         else if (m_ownsVals)
+             delete[] m_vals;
+     }
+
+    protected:
+    Vector_0() = default;
+
+    /// \brief For subclasses changing coordinates without detach()
+    void dropNorms() { m_normsValid = false; }
+    bool cachesNorms() const { return m_cacheNorms; }
+
+    private:
+    /// \brief distance() that may stop once NORM_INF result exceeds bound
+    int distanceBounded(IVector const* const right, NormType type, double& res, double bound) const;
+
+    typedef void (*BinaryKernel)(double* dst, const double* x, const double* y, size_t n);
+
+    /// \brief this = kernel(this, right), generic IVector path for non dense right
+    int elementwise(BinaryKernel kernels::Table::* kernel, IVector const* const right);
+
+    /// \brief Makes coordinates private to this vector before they are changed
+    ///
+    /// Cached norms are dropped here too, every mutator goes through it.
+    int detach();
+
+    double* m_vals;
+    size_t m_size;
+    bool m_ownsVals;
+    /// \brief Block m_vals points to, NULL if storage is not shared
+    SharedVals* m_shared;
+
+    /// \brief Norms by NormType, kept while m_normsValid
+    ///
+    /// Filled by const norm() calls, so vector with cached norms
+    /// should not be read by several threads at once.
+    mutable double m_norms[DIMENSION_NORM];
+    mutable bool m_normsValid;
+    bool m_cacheNorms;
+    bool m_pinned;
+
+    /*non default copyable*/
+    Vector_0(const IVector& other) = delete;
+    void operator=(const Vector_0& other) = delete;
+};
+
+/// \brief Small vector
+///
+/// Coordinates are stored after the object on the next cache line,
+/// so the vector costs one allocation instead of two.
+class Vector_S: public Vector_0{
+public:
+    /// \brief Largest dimension created as Vector_S by IVector::createVector
+    static const unsigned int maxDim = 16;
+
+    static Vector_S* create(unsigned int size, double const* vals);
+
+    /// Memory comes from storage::allocate() in create()
+    static void operator delete(void* ptr)
+    {
+        storage::release(ptr);
+    }
+
+    private:
+    Vector_S(unsigned int size, double *vals);
+};
+
+/// \brief Contiguous coordinates of vector
+///
+/// \returns NULL if vector does not expose its storage,
+/// coordinates should be read through getCoord() then
+double const* denseCoords(IVector const* const vector);
+
+/// \brief Writable view of vals[0], vals[stride], ... of size coordinates
+///
+/// Plain view for stride 1, otherwise view with no getCoordsPtr().
+IVector* createStridedView(unsigned int size, double* vals, unsigned int stride);
+
+/// \brief Coordinates of operand, copied if it has no storage
+class VectorOperand
+{
+public:
+    explicit VectorOperand(IVector const* const vector);
+
+    ~VectorOperand()
+    {
+        delete[] m_copy;
+    }
+
+    int result() const { return m_result; }
+    double const* coords() const { return m_coords; }
+
+private:
+    double const* m_coords;
+    double*       m_copy;
+    int           m_result;
+
+    /*non default copyable*/
+    VectorOperand(const VectorOperand& other) = delete;
+    void operator=(const VectorOperand& other) = delete;
+};
+
+/// \brief Explicitly stored coordinates of sparse vector
+struct SparseCoords
+{
+    unsigned int nnz;
+    /// strictly increasing
+    unsigned int const* indices;
+    double const* vals;
+};
+
+/// \brief Coordinates of vector created by IVector::createSparse
+///
+/// \returns false if vector is not sparse
+bool sparseCoords(IVector const* const vector, SparseCoords& coords);
+}
+
+#endif // VECTOR_0_H_
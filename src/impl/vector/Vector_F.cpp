@@ -0,0 +1,524 @@
+#include <IVector.h>
+#include <logging.h>
+#include <error.h>
+#include <cmath>
+#include <new>
+#include "kernels.h"
+#include "storage.h"
+#include "Vector_0.h"
+
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Vector keeping coordinates as float
+  ///
+  /// Halves memory traffic of big vectors. Elementwise operations
+  /// are done in float, reductions are accumulated in double.
+  /// Storage is not exposed as double, so double vectors read
+  /// float ones through getCoord(), IVector::convert() is faster
+  /// when they are mixed a lot.
+  class Vector_F : public IVector {
+  /// \brief IVector methods impl
+  public:
+    int getId() const;
+
+    /*operations*/
+    int add(IVector const* const right);
+    int subtract(IVector const* const right);
+    int multiplyByScalar(double scalar);
+    int dotProduct(IVector const* const right, double& res) const;
+
+    /*fused operations*/
+    int axpy(double alpha, IVector const* const x);
+    int axpby(double alpha, IVector const* const x, double beta);
+    int linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors);
+
+    /*comparators*/
+    int gt(IVector const* const right, NormType type, bool& result) const;
+    int lt(IVector const* const right, NormType type, bool& result) const;
+    int eq(IVector const* const right, NormType type, bool& result, double precision) const;
+    int distance(IVector const* const right, NormType type, double& res) const;
+
+    /*utils*/
+    unsigned int getDim() const;
+    int norm(NormType type, double& res) const;
+    int setCoord(unsigned int index, double elem);
+    int getCoord(unsigned int index, double & elem) const;
+    int setAllCoords(unsigned int dim, double* coords);
+    int getCoordsPtr(unsigned int & dim, double const*& elem) const;
+    int getMutableCoordsPtr(unsigned int & dim, double*& elem);
+    IVector* clone() const;
+
+  /// \brief Internal methods
+  public:
+    static Vector_F* create(unsigned int size);
+    ~Vector_F();
+
+    float const* floatCoords() const { return m_vals; }
+    float* floatCoords() { return m_vals; }
+
+  private:
+    Vector_F(unsigned int size, float* vals);
+
+    int checkOperand(IVector const* const right) const;
+    int distanceBounded(IVector const* const right, NormType type, double& res, double bound) const;
+
+  /// \brief Internal variables
+  private:
+    float* m_vals;
+    size_t m_size;
+  };
+
+  /// \brief Reads coordinates of other operand as double
+  ///
+  /// Float vectors are also exposed directly for float kernels.
+  class Operand {
+  public:
+    explicit Operand(IVector const* const vector)
+      : m_vector(vector),
+        m_floats(NULL),
+        m_doubles(NULL)
+    {
+      Vector_F const* floatVector = dynamic_cast<Vector_F const*>(vector);
+      if (floatVector)
+        m_floats = floatVector->floatCoords();
+      else
+        m_doubles = denseCoords(vector);
+    }
+
+    float const* floats() const { return m_floats; }
+
+    /// \brief Reads every coordinate of operand without storage,
+    /// so operations fail before they change anything
+    int check(size_t size) const
+    {
+      double coord;
+      for (size_t i = 0; !m_floats && !m_doubles && i < size; ++i) {
+        int errType = m_vector->getCoord(i, coord);
+        if (errType != ERR_OK)
+          LOG_RET("Failed to get coordinate", errType);
+      }
+      return ERR_OK;
+    }
+
+    int get(size_t index, double& coord) const
+    {
+      if (m_floats) {
+        coord = m_floats[index];
+        return ERR_OK;
+      }
+      if (m_doubles) {
+        coord = m_doubles[index];
+        return ERR_OK;
+      }
+      return m_vector->getCoord(index, coord);
+    }
+
+  private:
+    IVector const* m_vector;
+    float const*   m_floats;
+    double const*  m_doubles;
+  };
+
+  /// \brief Coordinates converted at once by linearCombination()
+  static const size_t blockSize = 512;
+} /* PIMPL_NAMESPACE */
+
+/* ---- IVector factory methods ---- */
+
+IVector* IVector::createVector(unsigned int size, double const* vals, Precision precision)
+{
+  switch (precision) {
+  case PRECISION_DOUBLE:
+    return createVector(size, vals);
+  case PRECISION_FLOAT:
+    break;
+  default:
+    LOG_RET("Unknown precision", NULL);
+  }
+
+  Vector_F* vect = Vector_F::create(size);
+  if (!vect)
+    LOG_RET("Failed to create float vector", NULL);
+
+  if (vals)
+    kernels::floatTable().narrow(vect->floatCoords(), vals, size);
+  return vect;
+}
+
+IVector* IVector::convert(IVector const* const vector, Precision precision)
+{
+  if (!vector)
+    LOG_RET("vector was NULL", NULL);
+
+  const unsigned int dim = vector->getDim();
+  double const* coords = denseCoords(vector);
+  if (coords)
+    return createVector(dim, coords, precision);
+
+  Vector_F const* floatVector = dynamic_cast<Vector_F const*>(vector);
+  if (floatVector && precision == PRECISION_DOUBLE) {
+    IVector* res = createVector(dim, NULL);
+    if (!res)
+      LOG_RET("Failed to create vector", NULL);
+
+    unsigned int resDim;
+    double* resCoords;
+    if (res->getUpdateCoordsPtr(resDim, resCoords) == ERR_OK) {
+      kernels::floatTable().widen(resCoords, floatVector->floatCoords(), dim);
+      return res;
+    }
+    delete res;
+  }
+
+  IVector* res = createVector(dim, NULL, precision);
+  if (!res)
+    LOG_RET("Failed to create vector", NULL);
+
+  for (unsigned int i = 0; i < dim; ++i) {
+    double coord;
+    if (vector->getCoord(i, coord) != ERR_OK || res->setCoord(i, coord) != ERR_OK) {
+      delete res;
+      LOG_RET("Failed to copy coordinate: " + std::to_string(i), NULL);
+    }
+  }
+  return res;
+}
+
+/* ---- Vector_F implementation ---- */
+
+Vector_F* Vector_F::create(unsigned int size)
+{
+  float* vals = static_cast<float*>(storage::allocate(size * sizeof(float)));
+  if (!vals)
+    LOG_RET("Not enough memory", NULL);
+  for (unsigned int i = 0; i < size; ++i)
+    vals[i] = 0.0f;
+
+  Vector_F* vect = new(std::nothrow) Vector_F(size, vals);
+  if (!vect) {
+    storage::release(vals);
+    LOG_RET("Not enough memory", NULL);
+  }
+  return vect;
+}
+
+Vector_F::Vector_F(unsigned int size, float* vals)
+  : m_vals(vals),
+    m_size(size)
+{  }
+
+Vector_F::~Vector_F()
+{
+  storage::release(m_vals);
+}
+
+int Vector_F::getId() const
+{
+  return IVector::INTERFACE_F32;
+}
+
+int Vector_F::checkOperand(IVector const* const right) const
+{
+  if (!right)
+    LOG_RET("right was NULL", ERR_WRONG_ARG);
+  if (m_size != right->getDim())
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+  return ERR_OK;
+}
+
+int Vector_F::add(IVector const* const right)
+{
+  return axpy(1.0, right);
+}
+
+int Vector_F::subtract(IVector const* const right)
+{
+  return axpy(-1.0, right);
+}
+
+int Vector_F::multiplyByScalar(double scalar)
+{
+  kernels::floatTable().scale(m_vals, m_vals, scalar, m_size);
+  return ERR_OK;
+}
+
+int Vector_F::dotProduct(IVector const* const right, double& res) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  Operand op(right);
+  if (op.floats()) {
+    res = kernels::floatTable().dot(m_vals, op.floats(), m_size);
+    return ERR_OK;
+  }
+
+  double resTmp = 0;
+  for (size_t i = 0; i < m_size; ++i) {
+    double coord;
+    errType = op.get(i, coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+    resTmp += m_vals[i] * coord;
+  }
+  res = resTmp;
+  return ERR_OK;
+}
+
+int Vector_F::axpy(double alpha, IVector const* const x)
+{
+  int errType = checkOperand(x);
+  if (errType != ERR_OK)
+    return errType;
+
+  Operand op(x);
+  if (op.floats()) {
+    const kernels::FloatTable& t = kernels::floatTable();
+    if (alpha == 1.0)
+      t.add(m_vals, m_vals, op.floats(), m_size);
+    else if (alpha == -1.0)
+      t.subtract(m_vals, m_vals, op.floats(), m_size);
+    else
+      t.axpy(m_vals, alpha, op.floats(), m_size);
+    return ERR_OK;
+  }
+
+  if ((errType = op.check(m_size)) != ERR_OK)
+    return errType;
+
+  for (size_t i = 0; i < m_size; ++i) {
+    double coord;
+    errType = op.get(i, coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+    m_vals[i] = static_cast<float>(m_vals[i] + alpha * coord);
+  }
+  return ERR_OK;
+}
+
+int Vector_F::axpby(double alpha, IVector const* const x, double beta)
+{
+  int errType = checkOperand(x);
+  if (errType != ERR_OK)
+    return errType;
+
+  Operand op(x);
+  if (op.floats()) {
+    kernels::floatTable().axpby(m_vals, alpha, op.floats(), beta, m_size);
+    return ERR_OK;
+  }
+
+  if ((errType = op.check(m_size)) != ERR_OK)
+    return errType;
+
+  for (size_t i = 0; i < m_size; ++i) {
+    double coord;
+    errType = op.get(i, coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+    m_vals[i] = static_cast<float>(alpha * coord + beta * m_vals[i]);
+  }
+  return ERR_OK;
+}
+
+int Vector_F::linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors)
+{
+  if (count > 0 && (!coefs || !vectors))
+    LOG_RET("NULL pointer", ERR_WRONG_ARG);
+
+  for (unsigned int k = 0; k < count; ++k) {
+    int errType = checkOperand(vectors[k]);
+    if (errType == ERR_OK)
+      errType = Operand(vectors[k]).check(m_size);
+    if (errType != ERR_OK)
+      return errType;
+  }
+
+  // Sum is kept in double block by block, this may be among terms
+  double block[blockSize];
+  for (size_t begin = 0; begin < m_size; begin += blockSize) {
+    const size_t len = m_size - begin < blockSize ? m_size - begin : blockSize;
+
+    for (size_t i = 0; i < len; ++i)
+      block[i] = 0;
+
+    for (unsigned int k = 0; k < count; ++k) {
+      Operand op(vectors[k]);
+      for (size_t i = 0; i < len; ++i) {
+        double coord;
+        int errType = op.get(begin + i, coord);
+        if (errType != ERR_OK)
+          LOG_RET("Failed to get coordinate", errType);
+        block[i] += coefs[k] * coord;
+      }
+    }
+
+    kernels::floatTable().narrow(m_vals + begin, block, len);
+  }
+  return ERR_OK;
+}
+
+int Vector_F::gt(IVector const* const right, NormType type, bool& result) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  double normResL, normResR;
+  if ((errType = norm(type, normResL)) != ERR_OK || (errType = right->norm(type, normResR)) != ERR_OK)
+    LOG_RET("Norm calculating failed", errType);
+
+  result = normResL > normResR;
+  return ERR_OK;
+}
+
+int Vector_F::lt(IVector const* const right, NormType type, bool& result) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  double normResL, normResR;
+  if ((errType = norm(type, normResL)) != ERR_OK || (errType = right->norm(type, normResR)) != ERR_OK)
+    LOG_RET("Norm calculating failed", errType);
+
+  result = normResL < normResR;
+  return ERR_OK;
+}
+
+int Vector_F::eq(IVector const* const right, NormType type, bool& result, double precision) const
+{
+  double distanceRes;
+  int errType = distanceBounded(right, type, distanceRes, precision);
+  if (errType != ERR_OK)
+    LOG_RET("Distance calculating failed", errType);
+
+  result = distanceRes < precision;
+  return ERR_OK;
+}
+
+int Vector_F::distance(IVector const* const right, NormType type, double& res) const
+{
+  return distanceBounded(right, type, res, HUGE_VAL);
+}
+
+int Vector_F::distanceBounded(IVector const* const right, NormType type, double& res, double bound) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+  if (type != NORM_1 && type != NORM_2 && type != NORM_INF)
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+
+  Operand op(right);
+  if (op.floats()) {
+    const kernels::FloatTable& t = kernels::floatTable();
+    res = type == NORM_1 ? t.distance1(m_vals, op.floats(), m_size) :
+          type == NORM_2 ? sqrt(t.distance2sq(m_vals, op.floats(), m_size)) :
+                           t.distanceInf(m_vals, op.floats(), m_size, bound);
+    return ERR_OK;
+  }
+
+  double resTmp = 0;
+  for (size_t i = 0; i < m_size; ++i) {
+    double coord;
+    errType = op.get(i, coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+
+    const double diff = fabs(m_vals[i] - coord);
+    if (type == NORM_1)
+      resTmp += diff;
+    else if (type == NORM_2)
+      resTmp += diff * diff;
+    else if (resTmp < diff)
+      resTmp = diff;
+
+    if (type == NORM_INF && resTmp > bound)
+      break;
+  }
+
+  res = type == NORM_2 ? sqrt(resTmp) : resTmp;
+  return ERR_OK;
+}
+
+unsigned int Vector_F::getDim() const
+{
+  return m_size;
+}
+
+int Vector_F::norm(NormType type, double& res) const
+{
+  const kernels::FloatTable& t = kernels::floatTable();
+  switch (type) {
+  case NORM_1:
+    res = t.norm1(m_vals, m_size);
+    break;
+  case NORM_2:
+    res = sqrt(t.norm2sq(m_vals, m_size));
+    break;
+  case NORM_INF:
+    res = t.normInf(m_vals, m_size);
+    break;
+  default:
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+  }
+  return ERR_OK;
+}
+
+int Vector_F::setCoord(unsigned int index, double elem)
+{
+  if (index >= m_size)
+    LOG_RET("Out of range", ERR_OUT_OF_RANGE);
+
+  m_vals[index] = static_cast<float>(elem);
+  return ERR_OK;
+}
+
+int Vector_F::getCoord(unsigned int index, double & elem) const
+{
+  if (index >= m_size)
+    LOG_RET("Out of range", ERR_OUT_OF_RANGE);
+
+  elem = m_vals[index];
+  return ERR_OK;
+}
+
+int Vector_F::setAllCoords(unsigned int dim, double* coords)
+{
+  if (dim != m_size)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+  if (!coords)
+    LOG_RET("coords was NULL", ERR_WRONG_ARG);
+
+  kernels::floatTable().narrow(m_vals, coords, m_size);
+  return ERR_OK;
+}
+
+int Vector_F::getCoordsPtr(unsigned int & dim, double const*& elem) const
+{
+  // No double storage, callers fall back to getCoord() silently
+  Q_UNUSED(dim);
+  Q_UNUSED(elem);
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int Vector_F::getMutableCoordsPtr(unsigned int & dim, double*& elem)
+{
+  Q_UNUSED(dim);
+  Q_UNUSED(elem);
+  return ERR_NOT_IMPLEMENTED;
+}
+
+IVector* Vector_F::clone() const
+{
+  Vector_F* vect = create(m_size);
+  if (!vect)
+    LOG_RET("Failed to clone float vector", NULL);
+
+  for (size_t i = 0; i < m_size; ++i)
+    vect->m_vals[i] = m_vals[i];
+  return vect;
+}
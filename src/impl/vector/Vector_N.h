@@ -0,0 +1,243 @@
+#ifndef VECTOR_N_H_
+#define VECTOR_N_H_
+
+#include <cmath>
+#include <new>
+#include <logging.h>
+#include "Vector_0.h"
+
+namespace vector_impl {
+
+/// \brief Calls f(I), f(I + 1), ..., f(N - 1) without a loop
+template<unsigned int I, unsigned int N>
+struct Unroll
+{
+    template<class F>
+    static void run(F& f)
+    {
+        f(I);
+        Unroll<I + 1, N>::run(f);
+    }
+};
+
+template<unsigned int N>
+struct Unroll<N, N>
+{
+    template<class F>
+    static void run(F&)
+    {
+    }
+};
+
+/* ---- Unrolled coordinate operations ---- */
+
+struct AddOp
+{
+    double* l; double const* r;
+    void operator()(unsigned int i) { l[i] += r[i]; }
+};
+
+struct SubtractOp
+{
+    double* l; double const* r;
+    void operator()(unsigned int i) { l[i] -= r[i]; }
+};
+
+struct ScaleOp
+{
+    double* l; double scalar;
+    void operator()(unsigned int i) { l[i] *= scalar; }
+};
+
+struct AxpyOp
+{
+    double* l; double alpha; double const* r;
+    void operator()(unsigned int i) { l[i] += alpha * r[i]; }
+};
+
+struct DotOp
+{
+    double const* l; double const* r; double acc;
+    void operator()(unsigned int i) { acc += l[i] * r[i]; }
+};
+
+struct NormsOp
+{
+    double const* l; double acc1; double acc2; double accInf;
+    void operator()(unsigned int i)
+    {
+        const double a = std::fabs(l[i]);
+        acc1 += a;
+        acc2 += l[i] * l[i];
+        accInf = accInf < a ? a : accInf;
+    }
+};
+
+/// \brief Vector of dimension known at compile time
+///
+/// Coordinates are a member array, so the vector is a single allocation.
+/// Hot operations are unrolled for dense operands, anything
+/// else falls back to generic Vector_0 implementation.
+template<unsigned int N>
+class Vector_N: public Vector_0{
+public:
+    static Vector_N* create(double const* vals)
+    {
+        Vector_N* vect = new(std::nothrow) Vector_N(vals);
+        if (!vect)
+        {
+            LOG("ERR: Not enough memory");
+        }
+        return vect;
+    }
+
+    /// \brief Storage blocks keep m_coords on cache line
+    static void* operator new(size_t size, const std::nothrow_t&)
+    {
+        return storage::allocate(size);
+    }
+
+    static void operator delete(void* ptr)
+    {
+        storage::release(ptr);
+    }
+
+    /*operations*/
+     int add(IVector const* const right)
+     {
+         double const* r = dense(right);
+         if (!r)
+             return Vector_0::add(right);
+
+         dropNorms();
+         AddOp op = { m_coords, r };
+         Unroll<0, N>::run(op);
+         return ERR_OK;
+     }
+
+     int subtract(IVector const* const right)
+     {
+         double const* r = dense(right);
+         if (!r)
+             return Vector_0::subtract(right);
+
+         dropNorms();
+         SubtractOp op = { m_coords, r };
+         Unroll<0, N>::run(op);
+         return ERR_OK;
+     }
+
+     int multiplyByScalar(double scalar)
+     {
+         dropNorms();
+         ScaleOp op = { m_coords, scalar };
+         Unroll<0, N>::run(op);
+         return ERR_OK;
+     }
+
+     int dotProduct(IVector const* const right, double& res) const
+     {
+         double const* r = dense(right);
+         if (!r)
+             return Vector_0::dotProduct(right, res);
+
+         DotOp op = { m_coords, r, 0.0 };
+         Unroll<0, N>::run(op);
+         res = op.acc;
+         return ERR_OK;
+     }
+
+     int axpy(double alpha, IVector const* const x)
+     {
+         double const* r = dense(x);
+         if (!r)
+             return Vector_0::axpy(alpha, x);
+
+         dropNorms();
+         AxpyOp op = { m_coords, alpha, r };
+         Unroll<0, N>::run(op);
+         return ERR_OK;
+     }
+
+    /*utils*/
+     unsigned int getDim() const
+     {
+         return N;
+     }
+
+     int norm(NormType type, double& res) const
+     {
+         if (cachesNorms())
+             return Vector_0::norm(type, res);
+
+         NormsOp op = { m_coords, 0.0, 0.0, 0.0 };
+
+         switch (type)
+         {
+         case NORM_1:
+         case NORM_2:
+         case NORM_INF:
+             Unroll<0, N>::run(op);
+             break;
+         default:
+             LOG("ERR: Unknown norm type");
+             return ERR_NORM_NOT_DEFINED;
+         }
+
+         res = type == NORM_1 ? op.acc1 :
+               type == NORM_2 ? std::sqrt(op.acc2) : op.accInf;
+         return ERR_OK;
+     }
+
+     int setCoord(unsigned int index, double elem)
+     {
+         if (index >= N)
+         {
+             LOG("ERR: Out of range");
+             return ERR_OUT_OF_RANGE;
+         }
+         dropNorms();
+         m_coords[index] = elem;
+         return ERR_OK;
+     }
+
+     int getCoord(unsigned int index, double & elem) const
+     {
+         if (index >= N)
+         {
+             LOG("ERR: Out of range");
+             return ERR_OUT_OF_RANGE;
+         }
+         elem = m_coords[index];
+         return ERR_OK;
+     }
+
+     IVector* clone() const
+     {
+         return create(m_coords);
+     }
+
+    private:
+    explicit Vector_N(double const* vals)
+      : Vector_0(N, m_coords, false)
+    {
+        for (unsigned int i = 0; i < N; ++i)
+        {
+            m_coords[i] = vals ? vals[i] : 0.0;
+        }
+    }
+
+    /// \brief Coordinates of operand if it is dense and of the same dimension
+    static double const* dense(IVector const* const right)
+    {
+        if (!right || right->getDim() != N)
+            return NULL;
+        return denseCoords(right);
+    }
+
+    alignas(storage::cacheLine) double m_coords[N];
+};
+
+}
+
+#endif // VECTOR_N_H_
@@ -0,0 +1,526 @@
+#include <IVector.h>
+#include <logging.h>
+#include <error.h>
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <QVector>
+#include "Vector_0.h"
+
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Vector keeping only nonzero coordinates
+  ///
+  /// Indices are sorted, so operations with other sparse vectors
+  /// are merges and operations with dense ones touch only stored
+  /// coordinates where result allows it. Cost is O(nnz) instead of O(dim)
+  /// for dotProduct() and norm(); add() is O(nnz) for sparse operands.
+  class Vector_Sparse : public IVector {
+  /// \brief IVector methods impl
+  public:
+    int getId() const;
+
+    /*operations*/
+    int add(IVector const* const right);
+    int subtract(IVector const* const right);
+    int multiplyByScalar(double scalar);
+    int dotProduct(IVector const* const right, double& res) const;
+
+    /*fused operations*/
+    int axpy(double alpha, IVector const* const x);
+    int axpby(double alpha, IVector const* const x, double beta);
+    int linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors);
+
+    /*comparators*/
+    int gt(IVector const* const right, NormType type, bool& result) const;
+    int lt(IVector const* const right, NormType type, bool& result) const;
+    int eq(IVector const* const right, NormType type, bool& result, double precision) const;
+    int distance(IVector const* const right, NormType type, double& res) const;
+
+    /*utils*/
+    unsigned int getDim() const;
+    int norm(NormType type, double& res) const;
+    int setCoord(unsigned int index, double elem);
+    int getCoord(unsigned int index, double & elem) const;
+    int setAllCoords(unsigned int dim, double* coords);
+    int getCoordsPtr(unsigned int & dim, double const*& elem) const;
+    int getMutableCoordsPtr(unsigned int & dim, double*& elem);
+    IVector* clone() const;
+
+  /// \brief Internal methods
+  public:
+    explicit Vector_Sparse(unsigned int size);
+
+    SparseCoords coords() const;
+    void assign(QVector<unsigned int>& indices, QVector<double>& vals);
+
+  private:
+    int checkOperand(IVector const* const right) const;
+    int distanceBounded(IVector const* const right, NormType type, double& res, double bound) const;
+
+  /// \brief Internal variables
+  private:
+    size_t m_size;
+    QVector<unsigned int> m_indices;
+    QVector<double> m_vals;
+  };
+
+  /// \brief Coordinate of non sparse vector, dense is its storage or NULL
+  int coordOf(IVector const* const vector, double const* dense, unsigned int index, double& coord)
+  {
+    if (dense) {
+      coord = dense[index];
+      return ERR_OK;
+    }
+    return vector->getCoord(index, coord);
+  }
+
+  /// \brief out = beta * a + alpha * x, zero results are not stored
+  ///
+  /// Merge of index lists if x is sparse, otherwise every coordinate
+  /// of x is visited once. x may be the vector a came from.
+  int merge(unsigned int size, const SparseCoords& a, double beta,
+            IVector const* const x, double alpha,
+            QVector<unsigned int>& outIndices, QVector<double>& outVals)
+  {
+    outIndices.clear();
+    outVals.clear();
+
+    SparseCoords xs;
+    if (sparseCoords(x, xs)) {
+      outIndices.reserve(a.nnz + xs.nnz);
+      outVals.reserve(a.nnz + xs.nnz);
+
+      unsigned int i = 0, j = 0;
+      while (i < a.nnz || j < xs.nnz) {
+        unsigned int index;
+        double val;
+        if (j == xs.nnz || (i < a.nnz && a.indices[i] < xs.indices[j])) {
+          index = a.indices[i];
+          val = beta * a.vals[i++];
+        } else if (i == a.nnz || xs.indices[j] < a.indices[i]) {
+          index = xs.indices[j];
+          val = alpha * xs.vals[j++];
+        } else {
+          index = a.indices[i];
+          val = beta * a.vals[i++] + alpha * xs.vals[j++];
+        }
+
+        if (val != 0.0) {
+          outIndices.append(index);
+          outVals.append(val);
+        }
+      }
+      return ERR_OK;
+    }
+
+    double const* dense = denseCoords(x);
+    unsigned int k = 0;
+    for (unsigned int i = 0; i < size; ++i) {
+      double coord;
+      int errType = coordOf(x, dense, i, coord);
+      if (errType != ERR_OK)
+        LOG_RET("Failed to get coordinate", errType);
+
+      double val = alpha * coord;
+      if (k < a.nnz && a.indices[k] == i)
+        val += beta * a.vals[k++];
+
+      if (val != 0.0) {
+        outIndices.append(i);
+        outVals.append(val);
+      }
+    }
+    return ERR_OK;
+  }
+} /* PIMPL_NAMESPACE */
+
+/* ---- IVector factory methods ---- */
+
+IVector* IVector::createSparse(unsigned int size, unsigned int nnz, unsigned int const* indices, double const* vals)
+{
+  if (nnz > 0 && (!indices || !vals))
+    LOG_RET("NULL pointer", NULL);
+  if (nnz > size)
+    LOG_RET("More coordinates than dimension", NULL);
+
+  for (unsigned int k = 0; k < nnz; ++k) {
+    if (indices[k] >= size)
+      LOG_RET("Index out of range: " + std::to_string(indices[k]), NULL);
+    if (k > 0 && indices[k] <= indices[k - 1])
+      LOG_RET("Indices are not strictly increasing", NULL);
+  }
+
+  Vector_Sparse* vect = new(std::nothrow) Vector_Sparse(size);
+  if (!vect)
+    LOG_RET("Not enough memory", NULL);
+
+  QVector<unsigned int> indicesNew;
+  QVector<double> valsNew;
+  indicesNew.reserve(nnz);
+  valsNew.reserve(nnz);
+  for (unsigned int k = 0; k < nnz; ++k) {
+    indicesNew.append(indices[k]);
+    valsNew.append(vals[k]);
+  }
+  vect->assign(indicesNew, valsNew);
+  return vect;
+}
+
+bool vector_impl::sparseCoords(IVector const* const vector, SparseCoords& coords)
+{
+  Vector_Sparse const* sparse = dynamic_cast<Vector_Sparse const*>(vector);
+  if (!sparse)
+    return false;
+
+  coords = sparse->coords();
+  return true;
+}
+
+/* ---- Vector_Sparse implementation ---- */
+
+Vector_Sparse::Vector_Sparse(unsigned int size)
+  : m_size(size),
+    m_indices(),
+    m_vals()
+{  }
+
+int Vector_Sparse::getId() const
+{
+  return IVector::INTERFACE_SPARSE;
+}
+
+SparseCoords Vector_Sparse::coords() const
+{
+  SparseCoords res = { static_cast<unsigned int>(m_indices.size()), m_indices.data(), m_vals.data() };
+  return res;
+}
+
+void Vector_Sparse::assign(QVector<unsigned int>& indices, QVector<double>& vals)
+{
+  m_indices.swap(indices);
+  m_vals.swap(vals);
+}
+
+int Vector_Sparse::checkOperand(IVector const* const right) const
+{
+  if (!right)
+    LOG_RET("right was NULL", ERR_WRONG_ARG);
+  if (m_size != right->getDim())
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+  return ERR_OK;
+}
+
+int Vector_Sparse::add(IVector const* const right)
+{
+  return axpby(1.0, right, 1.0);
+}
+
+int Vector_Sparse::subtract(IVector const* const right)
+{
+  return axpby(-1.0, right, 1.0);
+}
+
+int Vector_Sparse::multiplyByScalar(double scalar)
+{
+  if (scalar == 0.0) {
+    m_indices.clear();
+    m_vals.clear();
+    return ERR_OK;
+  }
+
+  for (int k = 0; k < m_vals.size(); ++k)
+    m_vals[k] *= scalar;
+  return ERR_OK;
+}
+
+int Vector_Sparse::dotProduct(IVector const* const right, double& res) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  const SparseCoords own = coords();
+  double resTmp = 0;
+
+  SparseCoords rs;
+  if (sparseCoords(right, rs)) {
+    unsigned int i = 0, j = 0;
+    while (i < own.nnz && j < rs.nnz) {
+      if (own.indices[i] < rs.indices[j])
+        ++i;
+      else if (rs.indices[j] < own.indices[i])
+        ++j;
+      else
+        resTmp += own.vals[i++] * rs.vals[j++];
+    }
+    res = resTmp;
+    return ERR_OK;
+  }
+
+  double const* dense = denseCoords(right);
+  for (unsigned int k = 0; k < own.nnz; ++k) {
+    double coord;
+    errType = coordOf(right, dense, own.indices[k], coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+    resTmp += own.vals[k] * coord;
+  }
+  res = resTmp;
+  return ERR_OK;
+}
+
+int Vector_Sparse::axpy(double alpha, IVector const* const x)
+{
+  return axpby(alpha, x, 1.0);
+}
+
+int Vector_Sparse::axpby(double alpha, IVector const* const x, double beta)
+{
+  int errType = checkOperand(x);
+  if (errType != ERR_OK)
+    return errType;
+
+  QVector<unsigned int> indicesNew;
+  QVector<double> valsNew;
+  errType = merge(m_size, coords(), beta, x, alpha, indicesNew, valsNew);
+  if (errType != ERR_OK)
+    return errType;
+
+  assign(indicesNew, valsNew);
+  return ERR_OK;
+}
+
+int Vector_Sparse::linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors)
+{
+  if (count > 0 && (!coefs || !vectors))
+    LOG_RET("NULL pointer", ERR_WRONG_ARG);
+
+  for (unsigned int k = 0; k < count; ++k) {
+    int errType = checkOperand(vectors[k]);
+    if (errType != ERR_OK)
+      return errType;
+  }
+
+  // Own coordinates are replaced only after all terms, this may be among them
+  QVector<unsigned int> accIndices, nextIndices;
+  QVector<double> accVals, nextVals;
+  for (unsigned int k = 0; k < count; ++k) {
+    const SparseCoords acc = { static_cast<unsigned int>(accIndices.size()), accIndices.data(), accVals.data() };
+    int errType = merge(m_size, acc, 1.0, vectors[k], coefs[k], nextIndices, nextVals);
+    if (errType != ERR_OK)
+      return errType;
+
+    accIndices.swap(nextIndices);
+    accVals.swap(nextVals);
+  }
+
+  assign(accIndices, accVals);
+  return ERR_OK;
+}
+
+int Vector_Sparse::gt(IVector const* const right, NormType type, bool& result) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  double normResL, normResR;
+  if ((errType = norm(type, normResL)) != ERR_OK || (errType = right->norm(type, normResR)) != ERR_OK)
+    LOG_RET("Norm calculating failed", errType);
+
+  result = normResL > normResR;
+  return ERR_OK;
+}
+
+int Vector_Sparse::lt(IVector const* const right, NormType type, bool& result) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  double normResL, normResR;
+  if ((errType = norm(type, normResL)) != ERR_OK || (errType = right->norm(type, normResR)) != ERR_OK)
+    LOG_RET("Norm calculating failed", errType);
+
+  result = normResL < normResR;
+  return ERR_OK;
+}
+
+int Vector_Sparse::eq(IVector const* const right, NormType type, bool& result, double precision) const
+{
+  double distanceRes;
+  int errType = distanceBounded(right, type, distanceRes, precision);
+  if (errType != ERR_OK)
+    LOG_RET("Distance calculating failed", errType);
+
+  result = distanceRes < precision;
+  return ERR_OK;
+}
+
+int Vector_Sparse::distance(IVector const* const right, NormType type, double& res) const
+{
+  return distanceBounded(right, type, res, HUGE_VAL);
+}
+
+int Vector_Sparse::distanceBounded(IVector const* const right, NormType type, double& res, double bound) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+  if (type != NORM_1 && type != NORM_2 && type != NORM_INF)
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+
+  // Difference is as sparse as both operands together
+  QVector<unsigned int> diffIndices;
+  QVector<double> diffVals;
+  SparseCoords rs;
+  if (sparseCoords(right, rs)) {
+    errType = merge(m_size, coords(), 1.0, right, -1.0, diffIndices, diffVals);
+    if (errType != ERR_OK)
+      return errType;
+
+    double resTmp = 0;
+    for (int k = 0; k < diffVals.size() && !(type == NORM_INF && resTmp > bound); ++k) {
+      const double diff = fabs(diffVals[k]);
+      if (type == NORM_1)
+        resTmp += diff;
+      else if (type == NORM_2)
+        resTmp += diff * diff;
+      else if (resTmp < diff)
+        resTmp = diff;
+    }
+    res = type == NORM_2 ? sqrt(resTmp) : resTmp;
+    return ERR_OK;
+  }
+
+  const SparseCoords own = coords();
+  double const* dense = denseCoords(right);
+  double resTmp = 0;
+  unsigned int k = 0;
+  for (unsigned int i = 0; i < m_size && !(type == NORM_INF && resTmp > bound); ++i) {
+    double coord;
+    errType = coordOf(right, dense, i, coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+
+    if (k < own.nnz && own.indices[k] == i)
+      coord -= own.vals[k++];
+
+    const double diff = fabs(coord);
+    if (type == NORM_1)
+      resTmp += diff;
+    else if (type == NORM_2)
+      resTmp += diff * diff;
+    else if (resTmp < diff)
+      resTmp = diff;
+  }
+  res = type == NORM_2 ? sqrt(resTmp) : resTmp;
+  return ERR_OK;
+}
+
+unsigned int Vector_Sparse::getDim() const
+{
+  return m_size;
+}
+
+int Vector_Sparse::norm(NormType type, double& res) const
+{
+  double resTmp = 0;
+  switch (type) {
+  case NORM_1:
+    for (int k = 0; k < m_vals.size(); ++k)
+      resTmp += fabs(m_vals[k]);
+    break;
+  case NORM_2:
+    for (int k = 0; k < m_vals.size(); ++k)
+      resTmp += m_vals[k] * m_vals[k];
+    resTmp = sqrt(resTmp);
+    break;
+  case NORM_INF:
+    for (int k = 0; k < m_vals.size(); ++k)
+      if (resTmp < fabs(m_vals[k]))
+        resTmp = fabs(m_vals[k]);
+    break;
+  default:
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+  }
+  res = resTmp;
+  return ERR_OK;
+}
+
+int Vector_Sparse::setCoord(unsigned int index, double elem)
+{
+  if (index >= m_size)
+    LOG_RET("Out of range", ERR_OUT_OF_RANGE);
+
+  unsigned int const* begin = m_indices.data();
+  unsigned int const* end = begin + m_indices.size();
+  const int pos = std::lower_bound(begin, end, index) - begin;
+
+  if (pos < m_indices.size() && m_indices[pos] == index) {
+    m_vals[pos] = elem;
+  } else if (elem != 0.0) {
+    m_indices.insert(pos, index);
+    m_vals.insert(pos, elem);
+  }
+  return ERR_OK;
+}
+
+int Vector_Sparse::getCoord(unsigned int index, double & elem) const
+{
+  if (index >= m_size)
+    LOG_RET("Out of range", ERR_OUT_OF_RANGE);
+
+  unsigned int const* begin = m_indices.data();
+  unsigned int const* end = begin + m_indices.size();
+  unsigned int const* it = std::lower_bound(begin, end, index);
+
+  elem = it != end && *it == index ? m_vals[it - begin] : 0.0;
+  return ERR_OK;
+}
+
+int Vector_Sparse::setAllCoords(unsigned int dim, double* coords)
+{
+  if (dim != m_size)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+  if (!coords)
+    LOG_RET("coords was NULL", ERR_WRONG_ARG);
+
+  m_indices.clear();
+  m_vals.clear();
+  for (unsigned int i = 0; i < dim; ++i) {
+    if (coords[i] != 0.0) {
+      m_indices.append(i);
+      m_vals.append(coords[i]);
+    }
+  }
+  return ERR_OK;
+}
+
+int Vector_Sparse::getCoordsPtr(unsigned int & dim, double const*& elem) const
+{
+  // No dense storage, callers check sparseCoords() or use getCoord()
+  Q_UNUSED(dim);
+  Q_UNUSED(elem);
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int Vector_Sparse::getMutableCoordsPtr(unsigned int & dim, double*& elem)
+{
+  Q_UNUSED(dim);
+  Q_UNUSED(elem);
+  return ERR_NOT_IMPLEMENTED;
+}
+
+IVector* Vector_Sparse::clone() const
+{
+  Vector_Sparse* vect = new(std::nothrow) Vector_Sparse(m_size);
+  if (!vect)
+    LOG_RET("Not enough memory", NULL);
+
+  vect->m_indices = m_indices;
+  vect->m_vals = m_vals;
+  return vect;
+}
@@ -0,0 +1,614 @@
+#include <IVector.h>
+#include <logging.h>
+#include <error.h>
+#include <cmath>
+#include <new>
+#include <QVector>
+#include "Vector_0.h"
+
+using namespace vector_impl;
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief Coordinates processed at once, kept on stack
+  static const size_t blockSize = 256;
+
+  /// \brief Operands of linearCombination() kept on stack
+  static const unsigned int stackTerms = 16;
+
+  /// \brief Coordinates offset, offset + stride, ... of another vector
+  ///
+  /// Coordinates are processed by kernels::table() in blocks copied
+  /// to stack, so no operation allocates memory. Parents with storage
+  /// are accessed directly, others through getCoord() and setCoord().
+  class Vector_View : public IVector {
+  /// \brief IVector methods impl
+  public:
+    int getId() const;
+
+    /*operations*/
+    int add(IVector const* const right);
+    int subtract(IVector const* const right);
+    int multiplyByScalar(double scalar);
+    int dotProduct(IVector const* const right, double& res) const;
+
+    /*fused operations*/
+    int axpy(double alpha, IVector const* const x);
+    int axpby(double alpha, IVector const* const x, double beta);
+    int linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors);
+
+    /*comparators*/
+    int gt(IVector const* const right, NormType type, bool& result) const;
+    int lt(IVector const* const right, NormType type, bool& result) const;
+    int eq(IVector const* const right, NormType type, bool& result, double precision) const;
+    int distance(IVector const* const right, NormType type, double& res) const;
+
+    /*utils*/
+    unsigned int getDim() const;
+    int norm(NormType type, double& res) const;
+    int setCoord(unsigned int index, double elem);
+    int getCoord(unsigned int index, double & elem) const;
+    int setAllCoords(unsigned int dim, double* coords);
+    int getCoordsPtr(unsigned int & dim, double const*& elem) const;
+    int getMutableCoordsPtr(unsigned int & dim, double*& elem);
+    IVector* clone() const;
+
+  /// \brief Internal methods
+  public:
+    /// \brief vals is storage of parent, parent is used only without it
+    Vector_View(IVector* parent, double* vals, unsigned int offset, unsigned int length, unsigned int stride);
+
+    IVector* parent() const { return m_parent; }
+    double* vals() const { return m_vals; }
+    unsigned int offset() const { return m_offset; }
+    unsigned int stride() const { return m_stride; }
+
+    /// \brief Whether vector may keep coordinates of this view under other indices
+    ///
+    /// Such operands are changed while blocks of the view are written.
+    /// Vector with the same coordinates under the same indices is fine.
+    bool overlaps(IVector const* const vector) const;
+
+  private:
+    int checkOperand(IVector const* const right) const;
+
+    /// \brief Reads every coordinate of parent without storage,
+    /// so mutators fail before they change anything
+    int checkCoords() const;
+
+    /// \brief block = coordinates [begin, begin + len) of this view
+    int readBlock(size_t begin, size_t len, double* block) const;
+    /// \brief coordinates [begin, begin + len) of this view = block
+    int writeBlock(size_t begin, size_t len, double const* block);
+
+  /// \brief Internal variables
+  private:
+    IVector* m_parent;
+    double* m_vals;
+    unsigned int m_offset;
+    unsigned int m_length;
+    unsigned int m_stride;
+  };
+
+  /// \brief Operand read by blocks
+  ///
+  /// Dense coordinates are used in place, others are read through getCoord().
+  class Operand {
+  public:
+    Operand()
+      : m_vector(NULL),
+        m_coords(NULL)
+    {  }
+
+    /// \brief Operand of const operation
+    void init(IVector const* const vector)
+    {
+      m_vector = vector;
+      m_coords = denseCoords(vector);
+    }
+
+    /// \brief Operand of operation changing view
+    ///
+    /// Operand without storage is read once to check its coordinates,
+    /// one overlapping the view is copied, which is the only case allocating.
+    int init(IVector const* const vector, Vector_View const& view)
+    {
+      init(vector);
+
+      const unsigned int dim = vector->getDim();
+      if (view.overlaps(vector)) {
+        m_copy.resize(dim);
+        int errType = readBlock(0, dim, m_copy.data());
+        if (errType != ERR_OK)
+          return errType;
+        m_coords = m_copy.constData();
+        return ERR_OK;
+      }
+
+      for (unsigned int i = 0; !m_coords && i < dim; ++i) {
+        double coord;
+        int errType = vector->getCoord(i, coord);
+        if (errType != ERR_OK)
+          LOG_RET("Failed to get coordinate", errType);
+      }
+      return ERR_OK;
+    }
+
+    /// \brief Coordinates [begin, begin + len), read into buffer if operand has no storage
+    int block(size_t begin, size_t len, double* buffer, double const*& coords) const
+    {
+      if (m_coords) {
+        coords = m_coords + begin;
+        return ERR_OK;
+      }
+
+      coords = buffer;
+      return readBlock(begin, len, buffer);
+    }
+
+  private:
+    int readBlock(size_t begin, size_t len, double* buffer) const
+    {
+      if (m_coords) {
+        for (size_t i = 0; i < len; ++i)
+          buffer[i] = m_coords[begin + i];
+        return ERR_OK;
+      }
+
+      for (size_t i = 0; i < len; ++i) {
+        int errType = m_vector->getCoord(static_cast<unsigned int>(begin + i), buffer[i]);
+        if (errType != ERR_OK)
+          LOG_RET("Failed to get coordinate", errType);
+      }
+      return ERR_OK;
+    }
+
+    IVector const* m_vector;
+    double const* m_coords;
+    QVector<double> m_copy;
+  };
+} /* PIMPL_NAMESPACE */
+
+/* ---- IVector factory methods ---- */
+
+IVector* IVector::createSubVector(IVector* const parent, unsigned int offset, unsigned int length,
+                                  unsigned int stride)
+{
+  if (!parent)
+    LOG_RET("parent was NULL", NULL);
+  if (length == 0 || stride == 0)
+    LOG_RET("Wrong length or stride", NULL);
+
+  const unsigned long long last = offset + static_cast<unsigned long long>(length - 1) * stride;
+  if (last >= parent->getDim())
+    LOG_RET("Out of range", NULL);
+
+  // View of view looks at the same parent with combined offset and stride
+  IVector* root = parent;
+  double* vals = NULL;
+  Vector_View const* view = dynamic_cast<Vector_View const*>(parent);
+  Vector_0* dense = view ? NULL : dynamic_cast<Vector_0*>(parent);
+  if (view) {
+    root = view->parent();
+    vals = view->vals();
+    offset = view->offset() + offset * view->stride();
+    stride *= view->stride();
+  } else if (dense) {
+    // Writing through pointers needs storage which stays in place
+    int errType = dense->pin();
+    if (errType != ERR_OK)
+      LOG_RET("Failed to pin parent storage", NULL);
+
+    unsigned int dim;
+    parent->getMutableCoordsPtr(dim, vals);
+  }
+
+  if (vals)
+    return createStridedView(length, vals + offset, stride);
+
+  Vector_View* vect = new(std::nothrow) Vector_View(root, NULL, offset, length, stride);
+  if (!vect)
+    LOG_RET("Not enough memory", NULL);
+  return vect;
+}
+
+IVector* vector_impl::createStridedView(unsigned int size, double* vals, unsigned int stride)
+{
+  if (stride == 1)
+    return IVector::createView(size, vals);
+
+  Vector_View* vect = new(std::nothrow) Vector_View(NULL, vals, 0, size, stride);
+  if (!vect)
+    LOG_RET("Not enough memory", NULL);
+  return vect;
+}
+
+/* ---- Vector_View implementation ---- */
+
+Vector_View::Vector_View(IVector* parent, double* vals, unsigned int offset, unsigned int length, unsigned int stride)
+  : m_parent(parent),
+    m_vals(vals),
+    m_offset(offset),
+    m_length(length),
+    m_stride(stride)
+{  }
+
+int Vector_View::getId() const
+{
+  return IVector::INTERFACE_VIEW;
+}
+
+int Vector_View::checkOperand(IVector const* const right) const
+{
+  if (!right)
+    LOG_RET("right was NULL", ERR_WRONG_ARG);
+  if (m_length != right->getDim())
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+  return ERR_OK;
+}
+
+bool Vector_View::overlaps(IVector const* const vector) const
+{
+  if (vector == this)
+    return false;
+
+  Vector_View const* view = dynamic_cast<Vector_View const*>(vector);
+  if (view && view->m_vals == m_vals && view->m_parent == m_parent &&
+      view->m_offset == m_offset && view->m_stride == m_stride)
+    return false;
+
+  if (!m_vals)
+    return vector == m_parent || (view && view->m_parent == m_parent);
+
+  // Spans of storage, vector without it never shares memory with parent storage
+  double const* first = m_vals + m_offset;
+  double const* last = first + static_cast<size_t>(m_length - 1) * m_stride;
+  double const* otherFirst;
+  double const* otherLast;
+  if (view && view->m_vals) {
+    otherFirst = view->m_vals + view->m_offset;
+    otherLast = otherFirst + static_cast<size_t>(view->m_length - 1) * view->m_stride;
+  } else if ((otherFirst = denseCoords(vector)) != NULL) {
+    otherLast = otherFirst + vector->getDim() - 1;
+  } else {
+    return false;
+  }
+  return otherFirst <= last && first <= otherLast;
+}
+
+int Vector_View::checkCoords() const
+{
+  for (unsigned int i = 0; !m_vals && i < m_length; ++i) {
+    double coord;
+    int errType = m_parent->getCoord(m_offset + i * m_stride, coord);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+  }
+  return ERR_OK;
+}
+
+int Vector_View::readBlock(size_t begin, size_t len, double* block) const
+{
+  if (m_vals) {
+    double const* src = m_vals + m_offset + begin * m_stride;
+    for (size_t i = 0; i < len; ++i)
+      block[i] = src[i * m_stride];
+    return ERR_OK;
+  }
+
+  for (size_t i = 0; i < len; ++i) {
+    int errType = m_parent->getCoord(static_cast<unsigned int>(m_offset + (begin + i) * m_stride), block[i]);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to get coordinate", errType);
+  }
+  return ERR_OK;
+}
+
+int Vector_View::writeBlock(size_t begin, size_t len, double const* block)
+{
+  if (m_vals) {
+    double* dst = m_vals + m_offset + begin * m_stride;
+    for (size_t i = 0; i < len; ++i)
+      dst[i * m_stride] = block[i];
+    return ERR_OK;
+  }
+
+  for (size_t i = 0; i < len; ++i) {
+    int errType = m_parent->setCoord(static_cast<unsigned int>(m_offset + (begin + i) * m_stride), block[i]);
+    if (errType != ERR_OK)
+      LOG_RET("Failed to set coordinate", errType);
+  }
+  return ERR_OK;
+}
+
+int Vector_View::add(IVector const* const right)
+{
+  return axpby(1.0, right, 1.0);
+}
+
+int Vector_View::subtract(IVector const* const right)
+{
+  return axpby(-1.0, right, 1.0);
+}
+
+int Vector_View::multiplyByScalar(double scalar)
+{
+  int errType = checkCoords();
+  if (errType != ERR_OK)
+    return errType;
+
+  double own[blockSize];
+  for (size_t begin = 0; begin < m_length; begin += blockSize) {
+    const size_t len = m_length - begin < blockSize ? m_length - begin : blockSize;
+    if ((errType = readBlock(begin, len, own)) != ERR_OK)
+      return errType;
+    kernels::table().scale(own, own, scalar, len);
+    if ((errType = writeBlock(begin, len, own)) != ERR_OK)
+      return errType;
+  }
+  return ERR_OK;
+}
+
+int Vector_View::dotProduct(IVector const* const right, double& res) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  Operand operand;
+  operand.init(right);
+
+  double own[blockSize], buffer[blockSize];
+  double sum = 0;
+  for (size_t begin = 0; begin < m_length; begin += blockSize) {
+    const size_t len = m_length - begin < blockSize ? m_length - begin : blockSize;
+    double const* rightVals;
+    if ((errType = readBlock(begin, len, own)) != ERR_OK ||
+        (errType = operand.block(begin, len, buffer, rightVals)) != ERR_OK)
+      return errType;
+    sum += kernels::table().dot(own, rightVals, len);
+  }
+
+  res = sum;
+  return ERR_OK;
+}
+
+int Vector_View::axpy(double alpha, IVector const* const x)
+{
+  return axpby(alpha, x, 1.0);
+}
+
+int Vector_View::axpby(double alpha, IVector const* const x, double beta)
+{
+  int errType = checkOperand(x);
+  if (errType != ERR_OK)
+    return errType;
+
+  Operand operand;
+  if ((errType = operand.init(x, *this)) != ERR_OK || (errType = checkCoords()) != ERR_OK)
+    return errType;
+
+  double own[blockSize], buffer[blockSize];
+  for (size_t begin = 0; begin < m_length; begin += blockSize) {
+    const size_t len = m_length - begin < blockSize ? m_length - begin : blockSize;
+    double const* xVals;
+    if ((errType = readBlock(begin, len, own)) != ERR_OK ||
+        (errType = operand.block(begin, len, buffer, xVals)) != ERR_OK)
+      return errType;
+    kernels::table().axpby(own, alpha, xVals, beta, len);
+    if ((errType = writeBlock(begin, len, own)) != ERR_OK)
+      return errType;
+  }
+  return ERR_OK;
+}
+
+int Vector_View::linearCombination(unsigned int count, double const* coefs, IVector const* const* vectors)
+{
+  if (count > 0 && (!coefs || !vectors))
+    LOG_RET("NULL pointer", ERR_WRONG_ARG);
+
+  int errType;
+  for (unsigned int k = 0; k < count; ++k) {
+    if ((errType = checkOperand(vectors[k])) != ERR_OK)
+      return errType;
+  }
+
+  Operand onStack[stackTerms];
+  Operand* terms = count <= stackTerms ? onStack : new(std::nothrow) Operand[count];
+  if (!terms)
+    LOG_RET("Not enough memory", ERR_MEMORY_ALLOCATION);
+
+  errType = ERR_OK;
+  for (unsigned int k = 0; errType == ERR_OK && k < count; ++k)
+    errType = terms[k].init(vectors[k], *this);
+
+  // Same sums as kernels::linearCombination, block of every term is
+  // read before own block is written, this may be among them
+  const kernels::Table& t = kernels::table();
+  double own[blockSize], buffer[blockSize];
+  for (size_t begin = 0; errType == ERR_OK && begin < m_length; begin += blockSize) {
+    const size_t len = m_length - begin < blockSize ? m_length - begin : blockSize;
+    for (size_t i = 0; count == 0 && i < len; ++i)
+      own[i] = 0.0;
+
+    for (unsigned int k = 0; errType == ERR_OK && k < count; ++k) {
+      double const* termVals;
+      if ((errType = terms[k].block(begin, len, buffer, termVals)) != ERR_OK)
+        break;
+      if (k == 0)
+        t.scale(own, termVals, coefs[0], len);
+      else
+        t.axpy(own, coefs[k], termVals, len);
+    }
+
+    if (errType == ERR_OK)
+      errType = writeBlock(begin, len, own);
+  }
+
+  if (terms != onStack)
+    delete[] terms;
+  return errType;
+}
+
+int Vector_View::gt(IVector const* const right, NormType type, bool& result) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  double normResL, normResR;
+  if ((errType = norm(type, normResL)) != ERR_OK || (errType = right->norm(type, normResR)) != ERR_OK)
+    LOG_RET("Norm calculating failed", errType);
+
+  result = normResL > normResR;
+  return ERR_OK;
+}
+
+int Vector_View::lt(IVector const* const right, NormType type, bool& result) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+
+  double normResL, normResR;
+  if ((errType = norm(type, normResL)) != ERR_OK || (errType = right->norm(type, normResR)) != ERR_OK)
+    LOG_RET("Norm calculating failed", errType);
+
+  result = normResL < normResR;
+  return ERR_OK;
+}
+
+int Vector_View::eq(IVector const* const right, NormType type, bool& result, double precision) const
+{
+  double distanceRes;
+  int errType = distance(right, type, distanceRes);
+  if (errType != ERR_OK)
+    LOG_RET("Distance calculating failed", errType);
+
+  result = distanceRes < precision;
+  return ERR_OK;
+}
+
+int Vector_View::distance(IVector const* const right, NormType type, double& res) const
+{
+  int errType = checkOperand(right);
+  if (errType != ERR_OK)
+    return errType;
+  if (type < NORM_1 || type >= DIMENSION_NORM)
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+
+  Operand operand;
+  operand.init(right);
+
+  const kernels::Table& k = kernels::table();
+  double own[blockSize], buffer[blockSize];
+  double acc = 0;
+  for (size_t begin = 0; begin < m_length; begin += blockSize) {
+    const size_t len = m_length - begin < blockSize ? m_length - begin : blockSize;
+    double const* rightVals;
+    if ((errType = readBlock(begin, len, own)) != ERR_OK ||
+        (errType = operand.block(begin, len, buffer, rightVals)) != ERR_OK)
+      return errType;
+
+    if (type == NORM_1) {
+      acc += k.distance1(own, rightVals, len);
+    } else if (type == NORM_2) {
+      acc += k.distance2sq(own, rightVals, len);
+    } else {
+      const double partial = k.distanceInf(own, rightVals, len, HUGE_VAL);
+      acc = acc < partial ? partial : acc;
+    }
+  }
+
+  res = type == NORM_2 ? sqrt(acc) : acc;
+  return ERR_OK;
+}
+
+unsigned int Vector_View::getDim() const
+{
+  return m_length;
+}
+
+int Vector_View::norm(NormType type, double& res) const
+{
+  if (type < NORM_1 || type >= DIMENSION_NORM)
+    LOG_RET("Unknown norm type", ERR_NORM_NOT_DEFINED);
+
+  const kernels::Table& k = kernels::table();
+  double own[blockSize];
+  double acc = 0;
+  for (size_t begin = 0; begin < m_length; begin += blockSize) {
+    const size_t len = m_length - begin < blockSize ? m_length - begin : blockSize;
+    int errType = readBlock(begin, len, own);
+    if (errType != ERR_OK)
+      return errType;
+
+    if (type == NORM_1) {
+      acc += k.norm1(own, len);
+    } else if (type == NORM_2) {
+      acc += k.norm2sq(own, len);
+    } else {
+      const double partial = k.normInf(own, len);
+      acc = acc < partial ? partial : acc;
+    }
+  }
+
+  res = type == NORM_2 ? sqrt(acc) : acc;
+  return ERR_OK;
+}
+
+int Vector_View::setCoord(unsigned int index, double elem)
+{
+  if (index >= m_length)
+    LOG_RET("Out of range", ERR_OUT_OF_RANGE);
+
+  if (m_vals) {
+    m_vals[m_offset + static_cast<size_t>(index) * m_stride] = elem;
+    return ERR_OK;
+  }
+  return m_parent->setCoord(m_offset + index * m_stride, elem);
+}
+
+int Vector_View::getCoord(unsigned int index, double & elem) const
+{
+  if (index >= m_length)
+    LOG_RET("Out of range", ERR_OUT_OF_RANGE);
+
+  if (m_vals) {
+    elem = m_vals[m_offset + static_cast<size_t>(index) * m_stride];
+    return ERR_OK;
+  }
+  return m_parent->getCoord(m_offset + index * m_stride, elem);
+}
+
+int Vector_View::setAllCoords(unsigned int dim, double* coords)
+{
+  if (dim != m_length)
+    LOG_RET("Dimensions mismatch", ERR_DIMENSIONS_MISMATCH);
+  if (!coords)
+    LOG_RET("coords was NULL", ERR_WRONG_ARG);
+
+  return writeBlock(0, m_length, coords);
+}
+
+int Vector_View::getCoordsPtr(unsigned int & dim, double const*& elem) const
+{
+  // Coordinates are not contiguous, contiguous views are created as plain vectors
+  Q_UNUSED(dim);
+  Q_UNUSED(elem);
+  return ERR_NOT_IMPLEMENTED;
+}
+
+int Vector_View::getMutableCoordsPtr(unsigned int & dim, double*& elem)
+{
+  Q_UNUSED(dim);
+  Q_UNUSED(elem);
+  return ERR_NOT_IMPLEMENTED;
+}
+
+IVector* Vector_View::clone() const
+{
+  QVector<double> own(m_length);
+  if (readBlock(0, m_length, own.data()) != ERR_OK)
+    LOG_RET("Failed to get coordinates", NULL);
+  return createVector(m_length, own.constData());
+}
@@ -0,0 +1,601 @@
+#include "blas.h"
+#include "kernels.h"
+#include "parallel.h"
+
+#include <cstdint>
+#include <new>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define BLAS_X86 1
+  #include <immintrin.h>
+  #define BLAS_TARGET(isa) __attribute__((target(isa)))
+#else
+  #define BLAS_X86 0
+#endif
+
+namespace /* PIMPL_NAMESPACE */ {
+  /* ---- Micro-kernels ---- */
+
+  // Micro-kernels compute mr x nr tile of product of packed panels:
+  // tile[i * nr + j] = sum(a[p * mr + i] * b[p * nr + j]) over p < kc.
+  // dot4 gives dot products of four rows lda apart with x.
+
+  void microScalar(size_t kc, const double* a, const double* b, double* tile)
+  {
+    double acc[4 * 4] = { 0 };
+    for (size_t p = 0; p < kc; ++p, a += 4, b += 4)
+      for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 4; ++j)
+          acc[i * 4 + j] += a[i] * b[j];
+    for (size_t i = 0; i < 4 * 4; ++i)
+      tile[i] = acc[i];
+  }
+
+  void dot4Scalar(const double* a, size_t lda, const double* x, size_t n, double* res)
+  {
+    const double* a1 = a + lda;
+    const double* a2 = a1 + lda;
+    const double* a3 = a2 + lda;
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (size_t j = 0; j < n; ++j) {
+      s0 += a[j] * x[j];
+      s1 += a1[j] * x[j];
+      s2 += a2[j] * x[j];
+      s3 += a3[j] * x[j];
+    }
+    res[0] = s0;
+    res[1] = s1;
+    res[2] = s2;
+    res[3] = s3;
+  }
+
+#if BLAS_X86
+  /* ---- SSE2 micro-kernels, 4 x 4 tile ---- */
+
+  BLAS_TARGET("sse2")
+  void microSse2(size_t kc, const double* a, const double* b, double* tile)
+  {
+    __m128d c00 = _mm_setzero_pd(), c01 = _mm_setzero_pd();
+    __m128d c10 = _mm_setzero_pd(), c11 = _mm_setzero_pd();
+    __m128d c20 = _mm_setzero_pd(), c21 = _mm_setzero_pd();
+    __m128d c30 = _mm_setzero_pd(), c31 = _mm_setzero_pd();
+    for (size_t p = 0; p < kc; ++p, a += 4, b += 4) {
+      const __m128d b0 = _mm_loadu_pd(b);
+      const __m128d b1 = _mm_loadu_pd(b + 2);
+      __m128d ai;
+      #define MICRO_ROW(i)                                \
+        ai = _mm_load1_pd(a + i);                         \
+        c##i##0 = _mm_add_pd(c##i##0, _mm_mul_pd(ai, b0)); \
+        c##i##1 = _mm_add_pd(c##i##1, _mm_mul_pd(ai, b1));
+      MICRO_ROW(0) MICRO_ROW(1) MICRO_ROW(2) MICRO_ROW(3)
+      #undef MICRO_ROW
+    }
+    _mm_storeu_pd(tile + 0,  c00); _mm_storeu_pd(tile + 2,  c01);
+    _mm_storeu_pd(tile + 4,  c10); _mm_storeu_pd(tile + 6,  c11);
+    _mm_storeu_pd(tile + 8,  c20); _mm_storeu_pd(tile + 10, c21);
+    _mm_storeu_pd(tile + 12, c30); _mm_storeu_pd(tile + 14, c31);
+  }
+
+  BLAS_TARGET("sse2")
+  double hsumSse2(__m128d v)
+  {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+  }
+
+  BLAS_TARGET("sse2")
+  void dot4Sse2(const double* a, size_t lda, const double* x, size_t n, double* res)
+  {
+    const double* a1 = a + lda;
+    const double* a2 = a1 + lda;
+    const double* a3 = a2 + lda;
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    __m128d s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+      const __m128d xv = _mm_loadu_pd(x + j);
+      s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + j), xv));
+      s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a1 + j), xv));
+      s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_loadu_pd(a2 + j), xv));
+      s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_loadu_pd(a3 + j), xv));
+    }
+    res[0] = hsumSse2(s0);
+    res[1] = hsumSse2(s1);
+    res[2] = hsumSse2(s2);
+    res[3] = hsumSse2(s3);
+    for (; j < n; ++j) {
+      res[0] += a[j] * x[j];
+      res[1] += a1[j] * x[j];
+      res[2] += a2[j] * x[j];
+      res[3] += a3[j] * x[j];
+    }
+  }
+
+  /* ---- AVX2 micro-kernels, 6 x 8 tile ---- */
+
+  BLAS_TARGET("avx2,fma")
+  void microAvx2(size_t kc, const double* a, const double* b, double* tile)
+  {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+    for (size_t p = 0; p < kc; ++p, a += 6, b += 8) {
+      const __m256d b0 = _mm256_loadu_pd(b);
+      const __m256d b1 = _mm256_loadu_pd(b + 4);
+      __m256d ai;
+      #define MICRO_ROW(i)                             \
+        ai = _mm256_broadcast_sd(a + i);               \
+        c##i##0 = _mm256_fmadd_pd(ai, b0, c##i##0);    \
+        c##i##1 = _mm256_fmadd_pd(ai, b1, c##i##1);
+      MICRO_ROW(0) MICRO_ROW(1) MICRO_ROW(2) MICRO_ROW(3) MICRO_ROW(4) MICRO_ROW(5)
+      #undef MICRO_ROW
+    }
+    _mm256_storeu_pd(tile + 0,  c00); _mm256_storeu_pd(tile + 4,  c01);
+    _mm256_storeu_pd(tile + 8,  c10); _mm256_storeu_pd(tile + 12, c11);
+    _mm256_storeu_pd(tile + 16, c20); _mm256_storeu_pd(tile + 20, c21);
+    _mm256_storeu_pd(tile + 24, c30); _mm256_storeu_pd(tile + 28, c31);
+    _mm256_storeu_pd(tile + 32, c40); _mm256_storeu_pd(tile + 36, c41);
+    _mm256_storeu_pd(tile + 40, c50); _mm256_storeu_pd(tile + 44, c51);
+  }
+
+  BLAS_TARGET("avx2,fma")
+  double hsumAvx2(__m256d v)
+  {
+    const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+  }
+
+  BLAS_TARGET("avx2,fma")
+  void dot4Avx2(const double* a, size_t lda, const double* x, size_t n, double* res)
+  {
+    const double* a1 = a + lda;
+    const double* a2 = a1 + lda;
+    const double* a3 = a2 + lda;
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+      const __m256d xv = _mm256_loadu_pd(x + j);
+      s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + j), xv, s0);
+      s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a1 + j), xv, s1);
+      s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a2 + j), xv, s2);
+      s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a3 + j), xv, s3);
+    }
+    res[0] = hsumAvx2(s0);
+    res[1] = hsumAvx2(s1);
+    res[2] = hsumAvx2(s2);
+    res[3] = hsumAvx2(s3);
+    for (; j < n; ++j) {
+      res[0] += a[j] * x[j];
+      res[1] += a1[j] * x[j];
+      res[2] += a2[j] * x[j];
+      res[3] += a3[j] * x[j];
+    }
+  }
+
+  /* ---- AVX-512 micro-kernels, 8 x 16 tile ---- */
+
+  BLAS_TARGET("avx512f")
+  void microAvx512(size_t kc, const double* a, const double* b, double* tile)
+  {
+    __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+    __m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+    __m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+    __m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+    __m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+    __m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+    __m512d c60 = _mm512_setzero_pd(), c61 = _mm512_setzero_pd();
+    __m512d c70 = _mm512_setzero_pd(), c71 = _mm512_setzero_pd();
+    for (size_t p = 0; p < kc; ++p, a += 8, b += 16) {
+      const __m512d b0 = _mm512_loadu_pd(b);
+      const __m512d b1 = _mm512_loadu_pd(b + 8);
+      __m512d ai;
+      #define MICRO_ROW(i)                             \
+        ai = _mm512_set1_pd(a[i]);                     \
+        c##i##0 = _mm512_fmadd_pd(ai, b0, c##i##0);    \
+        c##i##1 = _mm512_fmadd_pd(ai, b1, c##i##1);
+      MICRO_ROW(0) MICRO_ROW(1) MICRO_ROW(2) MICRO_ROW(3)
+      MICRO_ROW(4) MICRO_ROW(5) MICRO_ROW(6) MICRO_ROW(7)
+      #undef MICRO_ROW
+    }
+    _mm512_storeu_pd(tile + 0,   c00); _mm512_storeu_pd(tile + 8,   c01);
+    _mm512_storeu_pd(tile + 16,  c10); _mm512_storeu_pd(tile + 24,  c11);
+    _mm512_storeu_pd(tile + 32,  c20); _mm512_storeu_pd(tile + 40,  c21);
+    _mm512_storeu_pd(tile + 48,  c30); _mm512_storeu_pd(tile + 56,  c31);
+    _mm512_storeu_pd(tile + 64,  c40); _mm512_storeu_pd(tile + 72,  c41);
+    _mm512_storeu_pd(tile + 80,  c50); _mm512_storeu_pd(tile + 88,  c51);
+    _mm512_storeu_pd(tile + 96,  c60); _mm512_storeu_pd(tile + 104, c61);
+    _mm512_storeu_pd(tile + 112, c70); _mm512_storeu_pd(tile + 120, c71);
+  }
+
+  BLAS_TARGET("avx512f")
+  void dot4Avx512(const double* a, size_t lda, const double* x, size_t n, double* res)
+  {
+    const double* a1 = a + lda;
+    const double* a2 = a1 + lda;
+    const double* a3 = a2 + lda;
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+      const __m512d xv = _mm512_loadu_pd(x + j);
+      s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + j), xv, s0);
+      s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a1 + j), xv, s1);
+      s2 = _mm512_fmadd_pd(_mm512_loadu_pd(a2 + j), xv, s2);
+      s3 = _mm512_fmadd_pd(_mm512_loadu_pd(a3 + j), xv, s3);
+    }
+    res[0] = _mm512_reduce_add_pd(s0);
+    res[1] = _mm512_reduce_add_pd(s1);
+    res[2] = _mm512_reduce_add_pd(s2);
+    res[3] = _mm512_reduce_add_pd(s3);
+    for (; j < n; ++j) {
+      res[0] += a[j] * x[j];
+      res[1] += a1[j] * x[j];
+      res[2] += a2[j] * x[j];
+      res[3] += a3[j] * x[j];
+    }
+  }
+#endif // BLAS_X86
+
+  /// \brief Micro-kernels of one instruction set and their tile shape
+  struct Micro
+  {
+    size_t mr;
+    size_t nr;
+    void (*kernel)(size_t kc, const double* a, const double* b, double* tile);
+    void (*dot4)(const double* a, size_t lda, const double* x, size_t n, double* res);
+  };
+
+  const Micro micros[kernels::DIMENSION_ISA] = {
+    { 4, 4,  microScalar, dot4Scalar },
+#if BLAS_X86
+    { 4, 4,  microSse2,   dot4Sse2 },
+    { 6, 8,  microAvx2,   dot4Avx2 },
+    { 8, 16, microAvx512, dot4Avx512 },
+#endif
+  };
+
+  /// \brief Largest mr * nr over micros
+  static const size_t maxTile = 8 * 16;
+
+  /* ---- Blocking ---- */
+
+  // Packed B panel (kc x nc) stays in L3, packed A block (mc x kc)
+  // in L2 and one B micro-panel (kc x nr) in L1 of every core.
+
+  /// \brief Depth of packed panels
+  static const size_t kc = 256;
+  /// \brief Rows of C computed by one task, in micro-panels
+  static const size_t mcPanels = 16;
+  /// \brief Columns of packed B panel, multiple of every nr
+  static const size_t nc = 2048;
+  /// \brief Rows of A packed at once, in mc blocks
+  static const size_t slabBlocks = 64;
+  /// \brief Products of fewer multiply-adds run on calling thread
+  static const size_t gemmParallelFlops = 1 << 21;
+  /// \brief Columns of y updated by one task in gemvT
+  static const size_t gemvTCols = 512;
+  /// \brief Packed buffers alignment
+  static const size_t alignment = 64;
+
+  size_t roundUp(size_t n, size_t step)
+  {
+    return (n + step - 1) / step * step;
+  }
+
+  size_t min(size_t a, size_t b)
+  {
+    return a < b ? a : b;
+  }
+
+  double* aligned(double* raw)
+  {
+    const uintptr_t p = reinterpret_cast<uintptr_t>(raw);
+    return reinterpret_cast<double*>((p + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+  }
+
+  /// \brief Runs tasks on the pool or one by one on calling thread
+  void run(bool threaded, size_t tasks, parallel::Task task, void* context)
+  {
+    if (threaded) {
+      parallel::forEach(tasks, task, context);
+      return;
+    }
+    for (size_t index = 0; index < tasks; ++index)
+      task(context, index);
+  }
+
+  /* ---- Packing ---- */
+
+  /// \brief Copies count x depth block into panels of width rows
+  ///
+  /// Element (i, p) is src[i * ld + p], or src[p * ld + i] if trans.
+  /// Panel q holds rows [q * width, (q + 1) * width) column by column,
+  /// rows past count are zero.
+  struct Pack
+  {
+    bool          trans;
+    const double* src;
+    size_t        ld;
+    size_t        count;
+    size_t        depth;
+    size_t        width;
+    double*       dst;
+    size_t        panelsPerTask;
+  };
+
+  void packTask(void* context, size_t index)
+  {
+    const Pack& pack = *static_cast<const Pack*>(context);
+    const size_t panels = (pack.count + pack.width - 1) / pack.width;
+    const size_t end = min(panels, (index + 1) * pack.panelsPerTask);
+    for (size_t q = index * pack.panelsPerTask; q < end; ++q) {
+      const size_t i0 = q * pack.width;
+      const size_t len = min(pack.width, pack.count - i0);
+      double* dst = pack.dst + i0 * pack.depth;
+      for (size_t p = 0; p < pack.depth; ++p, dst += pack.width) {
+        size_t i = 0;
+        if (pack.trans) {
+          const double* src = pack.src + p * pack.ld + i0;
+          for (; i < len; ++i)
+            dst[i] = src[i];
+        } else {
+          const double* src = pack.src + i0 * pack.ld + p;
+          for (; i < len; ++i)
+            dst[i] = src[i * pack.ld];
+        }
+        for (; i < pack.width; ++i)
+          dst[i] = 0;
+      }
+    }
+  }
+
+  void pack(bool threaded, bool trans, const double* src, size_t ld,
+            size_t count, size_t depth, size_t width, double* dst)
+  {
+    static const size_t panelsPerTask = 16;
+    const size_t panels = (count + width - 1) / width;
+    Pack context = { trans, src, ld, count, depth, width, dst, panelsPerTask };
+    run(threaded, (panels + panelsPerTask - 1) / panelsPerTask, packTask, &context);
+  }
+
+  /* ---- Tasks ---- */
+
+  /// \brief C block += alpha * packed A block * packed B panel
+  struct Gemm
+  {
+    const Micro*  micro;
+    size_t        mc;
+    size_t        rows;
+    size_t        cols;
+    size_t        depth;
+    size_t        groups;
+    size_t        groupCols;
+    const double* packedA;
+    const double* packedB;
+    double        alpha;
+    double*       c;
+    size_t        ldc;
+  };
+
+  /// \brief Task index selects mc rows and groupCols columns of C block
+  void gemmTask(void* context, size_t index)
+  {
+    const Gemm& g = *static_cast<const Gemm*>(context);
+    const size_t mr = g.micro->mr;
+    const size_t nr = g.micro->nr;
+    const size_t ib = index / g.groups * g.mc;
+    const size_t jb = index % g.groups * g.groupCols;
+    const size_t iEnd = min(ib + g.mc, g.rows);
+    const size_t jEnd = min(jb + g.groupCols, g.cols);
+
+    double tile[maxTile];
+    for (size_t jr = jb; jr < jEnd; jr += nr) {
+      const double* bp = g.packedB + jr * g.depth;
+      const size_t cols = min(nr, jEnd - jr);
+      for (size_t ir = ib; ir < iEnd; ir += mr) {
+        const size_t rows = min(mr, iEnd - ir);
+        g.micro->kernel(g.depth, g.packedA + ir * g.depth, bp, tile);
+
+        double* c = g.c + ir * g.ldc + jr;
+        for (size_t i = 0; i < rows; ++i, c += g.ldc)
+          for (size_t j = 0; j < cols; ++j)
+            c[j] += g.alpha * tile[i * nr + j];
+      }
+    }
+  }
+
+  struct Gemv
+  {
+    const Micro*  micro;
+    size_t        m;
+    size_t        n;
+    double        alpha;
+    const double* a;
+    size_t        lda;
+    const double* x;
+    double        beta;
+    double*       y;
+    size_t        perTask;
+  };
+
+  void storeGemv(const Gemv& g, size_t i, double dot)
+  {
+    g.y[i] = g.beta == 0 ? g.alpha * dot : g.alpha * dot + g.beta * g.y[i];
+  }
+
+  /// \brief Rows of A four at a time, so x is loaded once per four rows
+  void gemvTask(void* context, size_t index)
+  {
+    const Gemv& g = *static_cast<const Gemv*>(context);
+    const size_t end = min(g.m, (index + 1) * g.perTask);
+
+    double res[4];
+    size_t i = index * g.perTask;
+    for (; i + 4 <= end; i += 4) {
+      g.micro->dot4(g.a + i * g.lda, g.lda, g.x, g.n, res);
+      for (size_t r = 0; r < 4; ++r)
+        storeGemv(g, i + r, res[r]);
+    }
+    for (; i < end; ++i)
+      storeGemv(g, i, kernels::table().dot(g.a + i * g.lda, g.x, g.n));
+  }
+
+  /// \brief Columns of y, kept in L1 while rows of A are added to them
+  void gemvTTask(void* context, size_t index)
+  {
+    const Gemv& g = *static_cast<const Gemv*>(context);
+    const kernels::Table& serial = kernels::table();
+    const size_t j0 = index * g.perTask;
+    const size_t len = min(g.perTask, g.n - j0);
+
+    double* y = g.y + j0;
+    if (g.beta == 0) {
+      for (size_t j = 0; j < len; ++j)
+        y[j] = 0;
+    } else if (g.beta != 1) {
+      serial.scale(y, y, g.beta, len);
+    }
+
+    for (size_t i = 0; i < g.m; ++i)
+      serial.axpy(y, g.alpha * g.x[i], g.a + i * g.lda + j0, len);
+  }
+
+  /// \brief Rows of A += alpha * x[i] * y
+  void gerTask(void* context, size_t index)
+  {
+    const Gemv& g = *static_cast<const Gemv*>(context);
+    const kernels::Table& serial = kernels::table();
+    const size_t end = min(g.m, (index + 1) * g.perTask);
+    double* a = const_cast<double*>(g.a);
+    for (size_t i = index * g.perTask; i < end; ++i)
+      serial.axpy(a + i * g.lda, g.alpha * g.x[i], g.y, g.n);
+  }
+
+  /// \brief Whether m x n matrix pass is worth splitting across threads
+  bool threadedPass(size_t m, size_t n)
+  {
+    return m * n >= parallel::threshold() && parallel::concurrency() > 1;
+  }
+
+  /// \brief Rows per task, so that each one covers about a chunk of coordinates
+  size_t rowsPerTask(size_t n)
+  {
+    return roundUp(n < parallel::chunkSize ? parallel::chunkSize / (n ? n : 1) : 1, 4);
+  }
+} /* PIMPL_NAMESPACE */
+
+void blas::gemv(size_t m, size_t n, double alpha, const double* a, size_t lda,
+                const double* x, double beta, double* y)
+{
+  if (m == 0)
+    return;
+
+  const bool threaded = threadedPass(m, n);
+  const size_t perTask = threaded ? rowsPerTask(n) : roundUp(m, 4);
+  Gemv context = { &micros[kernels::table().isa], m, n, alpha, a, lda, x, beta, y, perTask };
+  run(threaded, (m + perTask - 1) / perTask, gemvTask, &context);
+}
+
+void blas::gemvT(size_t m, size_t n, double alpha, const double* a, size_t lda,
+                 const double* x, double beta, double* y)
+{
+  if (n == 0)
+    return;
+
+  Gemv context = { &micros[kernels::table().isa], m, n, alpha, a, lda, x, beta, y, gemvTCols };
+  run(threadedPass(m, n), (n + gemvTCols - 1) / gemvTCols, gemvTTask, &context);
+}
+
+void blas::ger(size_t m, size_t n, double alpha, const double* x, const double* y,
+               double* a, size_t lda)
+{
+  if (m == 0 || n == 0)
+    return;
+
+  const bool threaded = threadedPass(m, n);
+  const size_t perTask = threaded ? rowsPerTask(n) : m;
+  // Here a is written and y is read, gerTask casts them back
+  Gemv context = { &micros[kernels::table().isa], m, n, alpha, a, lda, x, 0, const_cast<double*>(y), perTask };
+  run(threaded, (m + perTask - 1) / perTask, gerTask, &context);
+}
+
+bool blas::gemm(bool transA, bool transB, size_t m, size_t n, size_t k,
+                double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+                double beta, double* c, size_t ldc)
+{
+  if (m == 0 || n == 0)
+    return true;
+
+  const Micro& micro = micros[kernels::table().isa];
+  const size_t mc = mcPanels * micro.mr;
+  const size_t slab = slabBlocks * mc;
+  const bool product = k != 0 && alpha != 0;
+
+  double* rawA = NULL;
+  double* rawB = NULL;
+  if (product) {
+    const size_t depth = min(k, kc);
+    rawA = new(std::nothrow) double[min(roundUp(m, micro.mr), slab) * depth + alignment / sizeof(double)];
+    rawB = new(std::nothrow) double[min(roundUp(n, micro.nr), nc) * depth + alignment / sizeof(double)];
+    if (!rawA || !rawB) {
+      delete[] rawA;
+      delete[] rawB;
+      return false;
+    }
+  }
+
+  const kernels::Table& serial = kernels::table();
+  for (size_t i = 0; i < m; ++i) {
+    double* row = c + i * ldc;
+    if (beta == 0) {
+      for (size_t j = 0; j < n; ++j)
+        row[j] = 0;
+    } else if (beta != 1) {
+      serial.scale(row, row, beta, n);
+    }
+  }
+
+  if (!product)
+    return true;
+
+  double* packedA = aligned(rawA);
+  double* packedB = aligned(rawB);
+  const bool threaded = m * n * k >= gemmParallelFlops && parallel::concurrency() > 1;
+  const size_t threads = parallel::concurrency();
+
+  // Packed A slab is reused for every panel of B
+  for (size_t i0 = 0; i0 < m; i0 += slab) {
+    const size_t rows = min(slab, m - i0);
+    const size_t blocks = (rows + mc - 1) / mc;
+
+    for (size_t p0 = 0; p0 < k; p0 += kc) {
+      const size_t depth = min(kc, k - p0);
+      pack(threaded, transA, transA ? a + p0 * lda + i0 : a + i0 * lda + p0, lda,
+           rows, depth, micro.mr, packedA);
+
+      for (size_t j0 = 0; j0 < n; j0 += nc) {
+        const size_t cols = min(nc, n - j0);
+        pack(threaded, !transB, transB ? b + j0 * ldb + p0 : b + p0 * ldb + j0, ldb,
+             cols, depth, micro.nr, packedB);
+
+        // Few row blocks leave threads idle, columns are split then too
+        size_t groups = 1;
+        if (threaded && blocks < threads)
+          groups = min((cols + micro.nr - 1) / micro.nr, (threads + blocks - 1) / blocks);
+        const size_t groupCols = roundUp((cols + groups - 1) / groups, micro.nr);
+        groups = (cols + groupCols - 1) / groupCols;
+
+        Gemm context = { &micro, mc, rows, cols, depth, groups, groupCols,
+                         packedA, packedB, alpha, c + i0 * ldc + j0, ldc };
+        run(threaded, blocks * groups, gemmTask, &context);
+      }
+    }
+  }
+
+  delete[] rawA;
+  delete[] rawB;
+  return true;
+}
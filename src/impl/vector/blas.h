@@ -0,0 +1,40 @@
+#ifndef VECTOR_BLAS_H_
+#define VECTOR_BLAS_H_
+
+#include <cstddef>
+
+/// \brief Dense row-major matrix kernels used by IMatrix implementations
+///
+/// Instruction set follows kernels::table(), large calls are split
+/// across parallel::forEach(). Every output coordinate is computed
+/// by one thread in fixed order, so results do not depend on the
+/// number of threads. Outputs must not overlap inputs.
+/// Rows of a matrix are ld coordinates apart, ld >= columns.
+namespace blas {
+  /// \brief y = alpha * A * x + beta * y, A is m x n
+  ///
+  /// beta == 0 overwrites y without reading it.
+  void gemv(size_t m, size_t n, double alpha, const double* a, size_t lda,
+            const double* x, double beta, double* y);
+
+  /// \brief y = alpha * A^T * x + beta * y, A is m x n, y has n coordinates
+  void gemvT(size_t m, size_t n, double alpha, const double* a, size_t lda,
+             const double* x, double beta, double* y);
+
+  /// \brief C = alpha * op(A) * op(B) + beta * C, C is m x n
+  ///
+  /// op(A) is m x k, op(B) is k x n, op transposes when trans flag is set.
+  /// Operands are packed into cache sized panels first.
+  /// beta == 0 overwrites C without reading it.
+  ///
+  /// \returns false if packing buffers cannot be allocated, C is untouched then
+  bool gemm(bool transA, bool transB, size_t m, size_t n, size_t k,
+            double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+            double beta, double* c, size_t ldc);
+
+  /// \brief A = A + alpha * x * y^T, A is m x n
+  void ger(size_t m, size_t n, double alpha, const double* x, const double* y,
+           double* a, size_t lda);
+}
+
+#endif // VECTOR_BLAS_H_
@@ -0,0 +1,1509 @@
+#include "kernels.h"
+
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define KERNELS_X86 1
+  #include <immintrin.h>
+  #define KERNELS_TARGET(isa) __attribute__((target(isa)))
+#else
+  #define KERNELS_X86 0
+#endif
+
+namespace /* PIMPL_NAMESPACE */ {
+  /* ---- Scalar kernels ---- */
+
+  void addScalar(double* dst, const double* x, const double* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] + y[i];
+  }
+
+  void subtractScalar(double* dst, const double* x, const double* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] - y[i];
+  }
+
+  void scaleScalar(double* dst, const double* x, double scalar, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] * scalar;
+  }
+
+  void axpyScalar(double* dst, double alpha, const double* x, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] += alpha * x[i];
+  }
+
+  void axpbyScalar(double* dst, double alpha, const double* x, double beta, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = alpha * x[i] + beta * dst[i];
+  }
+
+  void absoluteScalar(double* dst, const double* x, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = std::fabs(x[i]);
+  }
+
+  void signumScalar(double* dst, const double* x, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] > 0 ? 1.0 : x[i] < 0 ? -1.0 : 0.0;
+  }
+
+  void clampScalar(double* dst, const double* x, const double* lo, const double* hi, size_t n)
+  {
+    // Same operand order as MAXPD/MINPD, which return x if it is NaN
+    for (size_t i = 0; i < n; ++i) {
+      const double t = lo[i] > x[i] ? lo[i] : x[i];
+      dst[i] = hi[i] < t ? hi[i] : t;
+    }
+  }
+
+  void minimumScalar(double* dst, const double* x, const double* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] < y[i] ? x[i] : y[i];
+  }
+
+  void maximumScalar(double* dst, const double* x, const double* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] > y[i] ? x[i] : y[i];
+  }
+
+  void multiplyScalar(double* dst, const double* x, const double* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] * y[i];
+  }
+
+  void fmaScalar(double* dst, const double* x, const double* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] += x[i] * y[i];
+  }
+
+  double dotScalar(const double* x, const double* y, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += x[i] * y[i];
+    return res;
+  }
+
+  double norm1Scalar(const double* x, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += std::fabs(x[i]);
+    return res;
+  }
+
+  double norm2sqScalar(const double* x, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += x[i] * x[i];
+    return res;
+  }
+
+  double normInfScalar(const double* x, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      if (res < std::fabs(x[i]))
+        res = std::fabs(x[i]);
+    return res;
+  }
+
+  void normsScalar(const double* x, size_t n, double* res)
+  {
+    double acc1 = 0, acc2 = 0, accInf = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const double a = std::fabs(x[i]);
+      acc1 += a;
+      acc2 += x[i] * x[i];
+      if (accInf < a)
+        accInf = a;
+    }
+    res[0] = acc1;
+    res[1] = acc2;
+    res[2] = accInf;
+  }
+
+  double distance1Scalar(const double* x, const double* y, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  double distance2sqScalar(const double* x, const double* y, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += (x[i] - y[i]) * (x[i] - y[i]);
+    return res;
+  }
+
+  double distanceInfScalar(const double* x, const double* y, size_t n, double bound)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n && !(res > bound); ++i)
+      if (res < std::fabs(x[i] - y[i]))
+        res = std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  /* ---- Scalar float kernels ---- */
+
+  void addFloatScalar(float* dst, const float* x, const float* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] + y[i];
+  }
+
+  void subtractFloatScalar(float* dst, const float* x, const float* y, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] - y[i];
+  }
+
+  void scaleFloatScalar(float* dst, const float* x, double scalar, size_t n)
+  {
+    const float s = static_cast<float>(scalar);
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i] * s;
+  }
+
+  void axpyFloatScalar(float* dst, double alpha, const float* x, size_t n)
+  {
+    const float a = static_cast<float>(alpha);
+    for (size_t i = 0; i < n; ++i)
+      dst[i] += a * x[i];
+  }
+
+  void axpbyFloatScalar(float* dst, double alpha, const float* x, double beta, size_t n)
+  {
+    const float a = static_cast<float>(alpha);
+    const float b = static_cast<float>(beta);
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = a * x[i] + b * dst[i];
+  }
+
+  double dotFloatScalar(const float* x, const float* y, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += static_cast<double>(x[i]) * y[i];
+    return res;
+  }
+
+  double norm1FloatScalar(const float* x, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += std::fabs(static_cast<double>(x[i]));
+    return res;
+  }
+
+  double norm2sqFloatScalar(const float* x, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += static_cast<double>(x[i]) * x[i];
+    return res;
+  }
+
+  double normInfFloatScalar(const float* x, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      if (res < std::fabs(static_cast<double>(x[i])))
+        res = std::fabs(static_cast<double>(x[i]));
+    return res;
+  }
+
+  double distance1FloatScalar(const float* x, const float* y, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i)
+      res += std::fabs(static_cast<double>(x[i]) - y[i]);
+    return res;
+  }
+
+  double distance2sqFloatScalar(const float* x, const float* y, size_t n)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const double d = static_cast<double>(x[i]) - y[i];
+      res += d * d;
+    }
+    return res;
+  }
+
+  double distanceInfFloatScalar(const float* x, const float* y, size_t n, double bound)
+  {
+    double res = 0;
+    for (size_t i = 0; i < n && !(res > bound); ++i)
+      if (res < std::fabs(static_cast<double>(x[i]) - y[i]))
+        res = std::fabs(static_cast<double>(x[i]) - y[i]);
+    return res;
+  }
+
+  void narrowScalar(float* dst, const double* x, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<float>(x[i]);
+  }
+
+  void widenScalar(double* dst, const float* x, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = x[i];
+  }
+
+#if KERNELS_X86
+  /* ---- SSE2 kernels, 2 lanes ---- */
+
+  KERNELS_TARGET("sse2")
+  void addSse2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] + y[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void subtractSse2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] - y[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void scaleSse2(double* dst, const double* x, double scalar, size_t n)
+  {
+    const __m128d s = _mm_set1_pd(scalar);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(x + i), s));
+    for (; i < n; ++i)
+      dst[i] = x[i] * scalar;
+  }
+
+  KERNELS_TARGET("sse2")
+  void axpySse2(double* dst, double alpha, const double* x, size_t n)
+  {
+    const __m128d a = _mm_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+    for (; i < n; ++i)
+      dst[i] += alpha * x[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void axpbySse2(double* dst, double alpha, const double* x, double beta, size_t n)
+  {
+    const __m128d a = _mm_set1_pd(alpha);
+    const __m128d b = _mm_set1_pd(beta);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(x + i)),
+                                        _mm_mul_pd(b, _mm_loadu_pd(dst + i))));
+    for (; i < n; ++i)
+      dst[i] = alpha * x[i] + beta * dst[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void absoluteSse2(double* dst, const double* x, size_t n)
+  {
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_and_pd(_mm_loadu_pd(x + i), mask));
+    for (; i < n; ++i)
+      dst[i] = std::fabs(x[i]);
+  }
+
+  KERNELS_TARGET("sse2")
+  void signumSse2(double* dst, const double* x, size_t n)
+  {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      const __m128d v = _mm_loadu_pd(x + i);
+      _mm_storeu_pd(dst + i, _mm_sub_pd(_mm_and_pd(_mm_cmpgt_pd(v, zero), one),
+                                        _mm_and_pd(_mm_cmplt_pd(v, zero), one)));
+    }
+    for (; i < n; ++i)
+      dst[i] = x[i] > 0 ? 1.0 : x[i] < 0 ? -1.0 : 0.0;
+  }
+
+  KERNELS_TARGET("sse2")
+  void clampSse2(double* dst, const double* x, const double* lo, const double* hi, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_min_pd(_mm_loadu_pd(hi + i),
+                                        _mm_max_pd(_mm_loadu_pd(lo + i), _mm_loadu_pd(x + i))));
+    clampScalar(dst + i, x + i, lo + i, hi + i, n - i);
+  }
+
+  KERNELS_TARGET("sse2")
+  void minimumSse2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_min_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] < y[i] ? x[i] : y[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void maximumSse2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_max_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] > y[i] ? x[i] : y[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void multiplySse2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] * y[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  void fmaSse2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+      _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i),
+                                        _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i))));
+    for (; i < n; ++i)
+      dst[i] += x[i] * y[i];
+  }
+
+  KERNELS_TARGET("sse2")
+  double hsumSse2(__m128d v)
+  {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+  }
+
+  KERNELS_TARGET("sse2")
+  double dotSse2(const double* x, const double* y, size_t n)
+  {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i),     _mm_loadu_pd(y + i)));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double res = hsumSse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += x[i] * y[i];
+    return res;
+  }
+
+  KERNELS_TARGET("sse2")
+  double norm1Sse2(const double* x, size_t n)
+  {
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc0 = _mm_add_pd(acc0, _mm_and_pd(_mm_loadu_pd(x + i),     mask));
+      acc1 = _mm_add_pd(acc1, _mm_and_pd(_mm_loadu_pd(x + i + 2), mask));
+    }
+    double res = hsumSse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(x[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("sse2")
+  double norm2sqSse2(const double* x, size_t n)
+  {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m128d v0 = _mm_loadu_pd(x + i);
+      const __m128d v1 = _mm_loadu_pd(x + i + 2);
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(v0, v0));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(v1, v1));
+    }
+    double res = hsumSse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += x[i] * x[i];
+    return res;
+  }
+
+  KERNELS_TARGET("sse2")
+  double normInfSse2(const double* x, size_t n)
+  {
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    // MAXPD returns second operand if any is NaN, keep accumulator there
+    for (; i + 2 <= n; i += 2)
+      acc = _mm_max_pd(_mm_and_pd(_mm_loadu_pd(x + i), mask), acc);
+    double res = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(acc, acc), acc));
+    for (; i < n; ++i)
+      if (res < std::fabs(x[i]))
+        res = std::fabs(x[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("sse2")
+  void normsSse2(const double* x, size_t n, double* res)
+  {
+    // Same steps as norm1Sse2() and norm2sqSse2(), so results match them
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m128d acc10 = _mm_setzero_pd();
+    __m128d acc11 = _mm_setzero_pd();
+    __m128d acc20 = _mm_setzero_pd();
+    __m128d acc21 = _mm_setzero_pd();
+    __m128d accInf = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m128d v0 = _mm_loadu_pd(x + i);
+      const __m128d v1 = _mm_loadu_pd(x + i + 2);
+      const __m128d a0 = _mm_and_pd(v0, mask);
+      const __m128d a1 = _mm_and_pd(v1, mask);
+      acc10 = _mm_add_pd(acc10, a0);
+      acc11 = _mm_add_pd(acc11, a1);
+      acc20 = _mm_add_pd(acc20, _mm_mul_pd(v0, v0));
+      acc21 = _mm_add_pd(acc21, _mm_mul_pd(v1, v1));
+      accInf = _mm_max_pd(a0, accInf);
+      accInf = _mm_max_pd(a1, accInf);
+    }
+    double r1 = hsumSse2(_mm_add_pd(acc10, acc11));
+    double r2 = hsumSse2(_mm_add_pd(acc20, acc21));
+    double rInf = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(accInf, accInf), accInf));
+    for (; i < n; ++i) {
+      const double a = std::fabs(x[i]);
+      r1 += a;
+      r2 += x[i] * x[i];
+      if (rInf < a)
+        rInf = a;
+    }
+    res[0] = r1;
+    res[1] = r2;
+    res[2] = rInf;
+  }
+
+
+  KERNELS_TARGET("sse2")
+  double distance1Sse2(const double* x, const double* y, size_t n)
+  {
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc0 = _mm_add_pd(acc0, _mm_and_pd(_mm_sub_pd(_mm_loadu_pd(x + i),     _mm_loadu_pd(y + i)),     mask));
+      acc1 = _mm_add_pd(acc1, _mm_and_pd(_mm_sub_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)), mask));
+    }
+    double res = hsumSse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("sse2")
+  double distance2sqSse2(const double* x, const double* y, size_t n)
+  {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m128d d0 = _mm_sub_pd(_mm_loadu_pd(x + i),     _mm_loadu_pd(y + i));
+      const __m128d d1 = _mm_sub_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2));
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+    }
+    double res = hsumSse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += (x[i] - y[i]) * (x[i] - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("sse2")
+  double distanceInfSse2(const double* x, const double* y, size_t n, double bound)
+  {
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m128d b = _mm_set1_pd(bound);
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      acc = _mm_max_pd(_mm_and_pd(_mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)), mask), acc);
+      if (_mm_movemask_pd(_mm_cmpgt_pd(acc, b)))
+        break;
+    }
+    double res = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(acc, acc), acc));
+    for (; i < n && !(res > bound); ++i)
+      if (res < std::fabs(x[i] - y[i]))
+        res = std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  /* ---- AVX2 kernels, 4 lanes ---- */
+
+  KERNELS_TARGET("avx2,fma")
+  void addAvx2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] + y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void subtractAvx2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] - y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void scaleAvx2(double* dst, const double* x, double scalar, size_t n)
+  {
+    const __m256d s = _mm256_set1_pd(scalar);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), s));
+    for (; i < n; ++i)
+      dst[i] = x[i] * scalar;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void axpyAvx2(double* dst, double alpha, const double* x, size_t n)
+  {
+    const __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(dst + i)));
+    for (; i < n; ++i)
+      dst[i] += alpha * x[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void axpbyAvx2(double* dst, double alpha, const double* x, double beta, size_t n)
+  {
+    const __m256d a = _mm256_set1_pd(alpha);
+    const __m256d b = _mm256_set1_pd(beta);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i),
+                                                _mm256_mul_pd(b, _mm256_loadu_pd(dst + i))));
+    for (; i < n; ++i)
+      dst[i] = alpha * x[i] + beta * dst[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void absoluteAvx2(double* dst, const double* x, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_and_pd(_mm256_loadu_pd(x + i), mask));
+    for (; i < n; ++i)
+      dst[i] = std::fabs(x[i]);
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void signumAvx2(double* dst, const double* x, size_t n)
+  {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m256d v = _mm256_loadu_pd(x + i);
+      _mm256_storeu_pd(dst + i, _mm256_sub_pd(_mm256_and_pd(_mm256_cmp_pd(v, zero, _CMP_GT_OQ), one),
+                                              _mm256_and_pd(_mm256_cmp_pd(v, zero, _CMP_LT_OQ), one)));
+    }
+    for (; i < n; ++i)
+      dst[i] = x[i] > 0 ? 1.0 : x[i] < 0 ? -1.0 : 0.0;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void clampAvx2(double* dst, const double* x, const double* lo, const double* hi, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_min_pd(_mm256_loadu_pd(hi + i),
+                                              _mm256_max_pd(_mm256_loadu_pd(lo + i), _mm256_loadu_pd(x + i))));
+    clampScalar(dst + i, x + i, lo + i, hi + i, n - i);
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void minimumAvx2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_min_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] < y[i] ? x[i] : y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void maximumAvx2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_max_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] > y[i] ? x[i] : y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void multiplyAvx2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] * y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void fmaAvx2(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i),
+                                                _mm256_loadu_pd(dst + i)));
+    for (; i < n; ++i)
+      dst[i] += x[i] * y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double hsumAvx2(__m256d v)
+  {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double dotAvx2(const double* x, const double* y, size_t n)
+  {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i),     _mm256_loadu_pd(y + i),     acc0);
+      acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += x[i] * y[i];
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double norm1Avx2(const double* x, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm256_add_pd(acc0, _mm256_and_pd(_mm256_loadu_pd(x + i),     mask));
+      acc1 = _mm256_add_pd(acc1, _mm256_and_pd(_mm256_loadu_pd(x + i + 4), mask));
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(x[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double norm2sqAvx2(const double* x, size_t n)
+  {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256d v0 = _mm256_loadu_pd(x + i);
+      const __m256d v1 = _mm256_loadu_pd(x + i + 4);
+      acc0 = _mm256_fmadd_pd(v0, v0, acc0);
+      acc1 = _mm256_fmadd_pd(v1, v1, acc1);
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += x[i] * x[i];
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double normInfAvx2(const double* x, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      acc = _mm256_max_pd(_mm256_and_pd(_mm256_loadu_pd(x + i), mask), acc);
+    __m128d half = _mm_max_pd(_mm256_extractf128_pd(acc, 1), _mm256_castpd256_pd128(acc));
+    double res = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(half, half), half));
+    for (; i < n; ++i)
+      if (res < std::fabs(x[i]))
+        res = std::fabs(x[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void normsAvx2(const double* x, size_t n, double* res)
+  {
+    // Same steps as norm1Avx2() and norm2sqAvx2(), so results match them
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d acc10 = _mm256_setzero_pd();
+    __m256d acc11 = _mm256_setzero_pd();
+    __m256d acc20 = _mm256_setzero_pd();
+    __m256d acc21 = _mm256_setzero_pd();
+    __m256d accInf = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256d v0 = _mm256_loadu_pd(x + i);
+      const __m256d v1 = _mm256_loadu_pd(x + i + 4);
+      const __m256d a0 = _mm256_and_pd(v0, mask);
+      const __m256d a1 = _mm256_and_pd(v1, mask);
+      acc10 = _mm256_add_pd(acc10, a0);
+      acc11 = _mm256_add_pd(acc11, a1);
+      acc20 = _mm256_fmadd_pd(v0, v0, acc20);
+      acc21 = _mm256_fmadd_pd(v1, v1, acc21);
+      accInf = _mm256_max_pd(a0, accInf);
+      accInf = _mm256_max_pd(a1, accInf);
+    }
+    double r1 = hsumAvx2(_mm256_add_pd(acc10, acc11));
+    double r2 = hsumAvx2(_mm256_add_pd(acc20, acc21));
+    __m128d half = _mm_max_pd(_mm256_extractf128_pd(accInf, 1), _mm256_castpd256_pd128(accInf));
+    double rInf = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(half, half), half));
+    for (; i < n; ++i) {
+      const double a = std::fabs(x[i]);
+      r1 += a;
+      r2 += x[i] * x[i];
+      if (rInf < a)
+        rInf = a;
+    }
+    res[0] = r1;
+    res[1] = r2;
+    res[2] = rInf;
+  }
+
+
+  KERNELS_TARGET("avx2,fma")
+  double distance1Avx2(const double* x, const double* y, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm256_add_pd(acc0, _mm256_and_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i),     _mm256_loadu_pd(y + i)),     mask));
+      acc1 = _mm256_add_pd(acc1, _mm256_and_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)), mask));
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double distance2sqAvx2(const double* x, const double* y, size_t n)
+  {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(x + i),     _mm256_loadu_pd(y + i));
+      const __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+      acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+      acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += (x[i] - y[i]) * (x[i] - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double distanceInfAvx2(const double* x, const double* y, size_t n, double bound)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m256d b = _mm256_set1_pd(bound);
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc = _mm256_max_pd(_mm256_and_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)), mask), acc);
+      if (_mm256_movemask_pd(_mm256_cmp_pd(acc, b, _CMP_GT_OQ)))
+        break;
+    }
+    __m128d half = _mm_max_pd(_mm256_extractf128_pd(acc, 1), _mm256_castpd256_pd128(acc));
+    double res = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(half, half), half));
+    for (; i < n && !(res > bound); ++i)
+      if (res < std::fabs(x[i] - y[i]))
+        res = std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  /* ---- AVX2 float kernels, 8 float lanes, 4 double accumulator lanes ---- */
+
+  KERNELS_TARGET("avx2,fma")
+  void addFloatAvx2(float* dst, const float* x, const float* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] + y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void subtractFloatAvx2(float* dst, const float* x, const float* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] - y[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void scaleFloatAvx2(float* dst, const float* x, double scalar, size_t n)
+  {
+    const float sf = static_cast<float>(scalar);
+    const __m256 s = _mm256_set1_ps(sf);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), s));
+    for (; i < n; ++i)
+      dst[i] = x[i] * sf;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void axpyFloatAvx2(float* dst, double alpha, const float* x, size_t n)
+  {
+    const float af = static_cast<float>(alpha);
+    const __m256 a = _mm256_set1_ps(af);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(dst + i)));
+    for (; i < n; ++i)
+      dst[i] += af * x[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void axpbyFloatAvx2(float* dst, double alpha, const float* x, double beta, size_t n)
+  {
+    const float af = static_cast<float>(alpha);
+    const float bf = static_cast<float>(beta);
+    const __m256 a = _mm256_set1_ps(af);
+    const __m256 b = _mm256_set1_ps(bf);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i),
+                                                _mm256_mul_ps(b, _mm256_loadu_ps(dst + i))));
+    for (; i < n; ++i)
+      dst[i] = af * x[i] + bf * dst[i];
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double dotFloatAvx2(const float* x, const float* y, size_t n)
+  {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)),
+                             _mm256_cvtps_pd(_mm_loadu_ps(y + i)), acc0);
+      acc1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)),
+                             _mm256_cvtps_pd(_mm_loadu_ps(y + i + 4)), acc1);
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += static_cast<double>(x[i]) * y[i];
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double norm1FloatAvx2(const float* x, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm256_add_pd(acc0, _mm256_and_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)),     mask));
+      acc1 = _mm256_add_pd(acc1, _mm256_and_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)), mask));
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(static_cast<double>(x[i]));
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double norm2sqFloatAvx2(const float* x, size_t n)
+  {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256d v0 = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+      const __m256d v1 = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4));
+      acc0 = _mm256_fmadd_pd(v0, v0, acc0);
+      acc1 = _mm256_fmadd_pd(v1, v1, acc1);
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += static_cast<double>(x[i]) * x[i];
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double normInfFloatAvx2(const float* x, size_t n)
+  {
+    // Maximum of floats is exact, so it is taken in float lanes
+    const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      acc = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(x + i), mask), acc);
+    __m128 half = _mm_max_ps(_mm256_extractf128_ps(acc, 1), _mm256_castps256_ps128(acc));
+    half = _mm_max_ps(_mm_movehl_ps(half, half), half);
+    half = _mm_max_ss(_mm_shuffle_ps(half, half, 1), half);
+    double res = _mm_cvtss_f32(half);
+    for (; i < n; ++i)
+      if (res < std::fabs(static_cast<double>(x[i])))
+        res = std::fabs(static_cast<double>(x[i]));
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double distance1FloatAvx2(const float* x, const float* y, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256d d0 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)),
+                                       _mm256_cvtps_pd(_mm_loadu_ps(y + i)));
+      const __m256d d1 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)),
+                                       _mm256_cvtps_pd(_mm_loadu_ps(y + i + 4)));
+      acc0 = _mm256_add_pd(acc0, _mm256_and_pd(d0, mask));
+      acc1 = _mm256_add_pd(acc1, _mm256_and_pd(d1, mask));
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(static_cast<double>(x[i]) - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double distance2sqFloatAvx2(const float* x, const float* y, size_t n)
+  {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256d d0 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)),
+                                       _mm256_cvtps_pd(_mm_loadu_ps(y + i)));
+      const __m256d d1 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)),
+                                       _mm256_cvtps_pd(_mm_loadu_ps(y + i + 4)));
+      acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+      acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+    }
+    double res = hsumAvx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i) {
+      const double d = static_cast<double>(x[i]) - y[i];
+      res += d * d;
+    }
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  double distanceInfFloatAvx2(const float* x, const float* y, size_t n, double bound)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m256d b = _mm256_set1_pd(bound);
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m256d d = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)),
+                                      _mm256_cvtps_pd(_mm_loadu_ps(y + i)));
+      acc = _mm256_max_pd(_mm256_and_pd(d, mask), acc);
+      if (_mm256_movemask_pd(_mm256_cmp_pd(acc, b, _CMP_GT_OQ)))
+        break;
+    }
+    __m128d half = _mm_max_pd(_mm256_extractf128_pd(acc, 1), _mm256_castpd256_pd128(acc));
+    double res = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(half, half), half));
+    for (; i < n && !(res > bound); ++i)
+      if (res < std::fabs(static_cast<double>(x[i]) - y[i]))
+        res = std::fabs(static_cast<double>(x[i]) - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void narrowAvx2(float* dst, const double* x, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(x + i)));
+    for (; i < n; ++i)
+      dst[i] = static_cast<float>(x[i]);
+  }
+
+  KERNELS_TARGET("avx2,fma")
+  void widenAvx2(double* dst, const float* x, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm_loadu_ps(x + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i];
+  }
+
+  /* ---- AVX-512 kernels, 8 lanes ---- */
+
+  KERNELS_TARGET("avx512f")
+  void addAvx512(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_add_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] + y[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void subtractAvx512(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] - y[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void scaleAvx512(double* dst, const double* x, double scalar, size_t n)
+  {
+    const __m512d s = _mm512_set1_pd(scalar);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_mul_pd(_mm512_loadu_pd(x + i), s));
+    for (; i < n; ++i)
+      dst[i] = x[i] * scalar;
+  }
+
+  KERNELS_TARGET("avx512f")
+  void axpyAvx512(double* dst, double alpha, const double* x, size_t n)
+  {
+    const __m512d a = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(dst + i)));
+    for (; i < n; ++i)
+      dst[i] += alpha * x[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void axpbyAvx512(double* dst, double alpha, const double* x, double beta, size_t n)
+  {
+    const __m512d a = _mm512_set1_pd(alpha);
+    const __m512d b = _mm512_set1_pd(beta);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i),
+                                                _mm512_mul_pd(b, _mm512_loadu_pd(dst + i))));
+    for (; i < n; ++i)
+      dst[i] = alpha * x[i] + beta * dst[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void absoluteAvx512(double* dst, const double* x, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_abs_pd(_mm512_loadu_pd(x + i)));
+    for (; i < n; ++i)
+      dst[i] = std::fabs(x[i]);
+  }
+
+  KERNELS_TARGET("avx512f")
+  void signumAvx512(double* dst, const double* x, size_t n)
+  {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d minusOne = _mm512_set1_pd(-1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m512d v = _mm512_loadu_pd(x + i);
+      __m512d res = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(v, zero, _CMP_GT_OQ), zero, one);
+      res = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(v, zero, _CMP_LT_OQ), res, minusOne);
+      _mm512_storeu_pd(dst + i, res);
+    }
+    for (; i < n; ++i)
+      dst[i] = x[i] > 0 ? 1.0 : x[i] < 0 ? -1.0 : 0.0;
+  }
+
+  KERNELS_TARGET("avx512f")
+  void clampAvx512(double* dst, const double* x, const double* lo, const double* hi, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_min_pd(_mm512_loadu_pd(hi + i),
+                                              _mm512_max_pd(_mm512_loadu_pd(lo + i), _mm512_loadu_pd(x + i))));
+    clampScalar(dst + i, x + i, lo + i, hi + i, n - i);
+  }
+
+  KERNELS_TARGET("avx512f")
+  void minimumAvx512(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_min_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] < y[i] ? x[i] : y[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void maximumAvx512(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_max_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] > y[i] ? x[i] : y[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void multiplyAvx512(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_mul_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    for (; i < n; ++i)
+      dst[i] = x[i] * y[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  void fmaAvx512(double* dst, const double* x, const double* y, size_t n)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_pd(dst + i, _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i),
+                                                _mm512_loadu_pd(dst + i)));
+    for (; i < n; ++i)
+      dst[i] += x[i] * y[i];
+  }
+
+  KERNELS_TARGET("avx512f")
+  double dotAvx512(const double* x, const double* y, size_t n)
+  {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i),     _mm512_loadu_pd(y + i),     acc0);
+      acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), acc1);
+    }
+    double res = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += x[i] * y[i];
+    return res;
+  }
+
+  KERNELS_TARGET("avx512f")
+  double norm1Avx512(const double* x, size_t n)
+  {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      acc0 = _mm512_add_pd(acc0, _mm512_abs_pd(_mm512_loadu_pd(x + i)));
+      acc1 = _mm512_add_pd(acc1, _mm512_abs_pd(_mm512_loadu_pd(x + i + 8)));
+    }
+    double res = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(x[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx512f")
+  double norm2sqAvx512(const double* x, size_t n)
+  {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m512d v0 = _mm512_loadu_pd(x + i);
+      const __m512d v1 = _mm512_loadu_pd(x + i + 8);
+      acc0 = _mm512_fmadd_pd(v0, v0, acc0);
+      acc1 = _mm512_fmadd_pd(v1, v1, acc1);
+    }
+    double res = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += x[i] * x[i];
+    return res;
+  }
+
+  KERNELS_TARGET("avx512f")
+  double normInfAvx512(const double* x, size_t n)
+  {
+    __m512d acc = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      acc = _mm512_max_pd(_mm512_abs_pd(_mm512_loadu_pd(x + i)), acc);
+    double res = _mm512_reduce_max_pd(acc);
+    for (; i < n; ++i)
+      if (res < std::fabs(x[i]))
+        res = std::fabs(x[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx512f")
+  void normsAvx512(const double* x, size_t n, double* res)
+  {
+    // Same steps as norm1Avx512() and norm2sqAvx512(), so results match them
+    __m512d acc10 = _mm512_setzero_pd();
+    __m512d acc11 = _mm512_setzero_pd();
+    __m512d acc20 = _mm512_setzero_pd();
+    __m512d acc21 = _mm512_setzero_pd();
+    __m512d accInf = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m512d v0 = _mm512_loadu_pd(x + i);
+      const __m512d v1 = _mm512_loadu_pd(x + i + 8);
+      const __m512d a0 = _mm512_abs_pd(v0);
+      const __m512d a1 = _mm512_abs_pd(v1);
+      acc10 = _mm512_add_pd(acc10, a0);
+      acc11 = _mm512_add_pd(acc11, a1);
+      acc20 = _mm512_fmadd_pd(v0, v0, acc20);
+      acc21 = _mm512_fmadd_pd(v1, v1, acc21);
+      accInf = _mm512_max_pd(a0, accInf);
+      accInf = _mm512_max_pd(a1, accInf);
+    }
+    double r1 = _mm512_reduce_add_pd(_mm512_add_pd(acc10, acc11));
+    double r2 = _mm512_reduce_add_pd(_mm512_add_pd(acc20, acc21));
+    double rInf = _mm512_reduce_max_pd(accInf);
+    for (; i < n; ++i) {
+      const double a = std::fabs(x[i]);
+      r1 += a;
+      r2 += x[i] * x[i];
+      if (rInf < a)
+        rInf = a;
+    }
+    res[0] = r1;
+    res[1] = r2;
+    res[2] = rInf;
+  }
+
+  KERNELS_TARGET("avx512f")
+  double distance1Avx512(const double* x, const double* y, size_t n)
+  {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      acc0 = _mm512_add_pd(acc0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(x + i),     _mm512_loadu_pd(y + i))));
+      acc1 = _mm512_add_pd(acc1, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8))));
+    }
+    double res = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += std::fabs(x[i] - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx512f")
+  double distance2sqAvx512(const double* x, const double* y, size_t n)
+  {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(x + i),     _mm512_loadu_pd(y + i));
+      const __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+      acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+      acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+    }
+    double res = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; i < n; ++i)
+      res += (x[i] - y[i]) * (x[i] - y[i]);
+    return res;
+  }
+
+  KERNELS_TARGET("avx512f")
+  double distanceInfAvx512(const double* x, const double* y, size_t n, double bound)
+  {
+    const __m512d b = _mm512_set1_pd(bound);
+    __m512d acc = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc = _mm512_max_pd(_mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i))), acc);
+      if (_mm512_cmp_pd_mask(acc, b, _CMP_GT_OQ))
+        break;
+    }
+    double res = _mm512_reduce_max_pd(acc);
+    for (; i < n && !(res > bound); ++i)
+      if (res < std::fabs(x[i] - y[i]))
+        res = std::fabs(x[i] - y[i]);
+    return res;
+  }
+#endif // KERNELS_X86
+
+  const kernels::Table tables[kernels::DIMENSION_ISA] = {
+    { kernels::ISA_SCALAR,
+      addScalar, subtractScalar, scaleScalar, axpyScalar, axpbyScalar,
+      absoluteScalar, signumScalar, clampScalar, minimumScalar, maximumScalar, multiplyScalar, fmaScalar,
+      dotScalar, norm1Scalar, norm2sqScalar, normInfScalar, normsScalar,
+      distance1Scalar, distance2sqScalar, distanceInfScalar },
+#if KERNELS_X86
+    { kernels::ISA_SSE2,
+      addSse2, subtractSse2, scaleSse2, axpySse2, axpbySse2,
+      absoluteSse2, signumSse2, clampSse2, minimumSse2, maximumSse2, multiplySse2, fmaSse2,
+      dotSse2, norm1Sse2, norm2sqSse2, normInfSse2, normsSse2,
+      distance1Sse2, distance2sqSse2, distanceInfSse2 },
+    { kernels::ISA_AVX2,
+      addAvx2, subtractAvx2, scaleAvx2, axpyAvx2, axpbyAvx2,
+      absoluteAvx2, signumAvx2, clampAvx2, minimumAvx2, maximumAvx2, multiplyAvx2, fmaAvx2,
+      dotAvx2, norm1Avx2, norm2sqAvx2, normInfAvx2, normsAvx2,
+      distance1Avx2, distance2sqAvx2, distanceInfAvx2 },
+    { kernels::ISA_AVX512,
+      addAvx512, subtractAvx512, scaleAvx512, axpyAvx512, axpbyAvx512,
+      absoluteAvx512, signumAvx512, clampAvx512, minimumAvx512, maximumAvx512, multiplyAvx512, fmaAvx512,
+      dotAvx512, norm1Avx512, norm2sqAvx512, normInfAvx512, normsAvx512,
+      distance1Avx512, distance2sqAvx512, distanceInfAvx512 },
+#endif
+  };
+
+  /// \brief Float kernels per instruction set
+  ///
+  /// SSE2 gains little over scalar loops for converting kernels,
+  /// AVX-512 machines run AVX2 ones.
+  const kernels::FloatTable floatTables[kernels::DIMENSION_ISA] = {
+    { addFloatScalar, subtractFloatScalar, scaleFloatScalar, axpyFloatScalar, axpbyFloatScalar,
+      dotFloatScalar, norm1FloatScalar, norm2sqFloatScalar, normInfFloatScalar,
+      distance1FloatScalar, distance2sqFloatScalar, distanceInfFloatScalar,
+      narrowScalar, widenScalar },
+#if KERNELS_X86
+    { addFloatScalar, subtractFloatScalar, scaleFloatScalar, axpyFloatScalar, axpbyFloatScalar,
+      dotFloatScalar, norm1FloatScalar, norm2sqFloatScalar, normInfFloatScalar,
+      distance1FloatScalar, distance2sqFloatScalar, distanceInfFloatScalar,
+      narrowScalar, widenScalar },
+    { addFloatAvx2, subtractFloatAvx2, scaleFloatAvx2, axpyFloatAvx2, axpbyFloatAvx2,
+      dotFloatAvx2, norm1FloatAvx2, norm2sqFloatAvx2, normInfFloatAvx2,
+      distance1FloatAvx2, distance2sqFloatAvx2, distanceInfFloatAvx2,
+      narrowAvx2, widenAvx2 },
+    { addFloatAvx2, subtractFloatAvx2, scaleFloatAvx2, axpyFloatAvx2, axpbyFloatAvx2,
+      dotFloatAvx2, norm1FloatAvx2, norm2sqFloatAvx2, normInfFloatAvx2,
+      distance1FloatAvx2, distance2sqFloatAvx2, distanceInfFloatAvx2,
+      narrowAvx2, widenAvx2 },
+#endif
+  };
+
+  /// \brief Kernels in use, chosen while library is loaded
+  const kernels::Table* active = &tables[kernels::detect()];
+} /* PIMPL_NAMESPACE */
+
+kernels::InstructionSet kernels::detect()
+{
+#if KERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return ISA_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return ISA_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return ISA_SSE2;
+#endif
+  return ISA_SCALAR;
+}
+
+const kernels::Table& kernels::table()
+{
+  // Guards use from other libraries static initializers
+  if (!active)
+    active = &tables[detect()];
+  return *active;
+}
+
+const kernels::FloatTable& kernels::floatTable()
+{
+  return floatTables[table().isa];
+}
+
+void kernels::linearCombination(double* dst, size_t count,
+                                const double* coefs, const double* const* xs, size_t n)
+{
+  static const size_t blockSize = 512;
+  double block[blockSize];
+
+  const Table& t = table();
+  for (size_t begin = 0; begin < n; begin += blockSize) {
+    const size_t len = n - begin < blockSize ? n - begin : blockSize;
+
+    if (count == 0) {
+      // Not dst * 0, which keeps NaN and infinities
+      for (size_t i = 0; i < len; ++i)
+        block[i] = 0.0;
+    } else {
+      t.scale(block, xs[0] + begin, coefs[0], len);
+      for (size_t k = 1; k < count; ++k)
+        t.axpy(block, coefs[k], xs[k] + begin, len);
+    }
+
+    for (size_t i = 0; i < len; ++i)
+      dst[begin + i] = block[i];
+  }
+}
+
+bool kernels::select(InstructionSet isa)
+{
+  if (isa < ISA_SCALAR || isa > detect())
+    return false;
+
+  active = &tables[isa];
+  return true;
+}
+
+const char* kernels::isaName(InstructionSet isa)
+{
+  switch (isa) {
+  case ISA_SCALAR: return "scalar";
+  case ISA_SSE2:   return "sse2";
+  case ISA_AVX2:   return "avx2";
+  case ISA_AVX512: return "avx512";
+  default:         return "unknown";
+  }
+}
@@ -0,0 +1,128 @@
+#ifndef VECTOR_KERNELS_H_
+#define VECTOR_KERNELS_H_
+
+#include <cstddef>
+
+/// \brief Dense double kernels used by IVector implementations
+///
+/// Every kernel exists in scalar, SSE2, AVX2 and AVX-512 flavours.
+/// The widest one supported by the running CPU is selected when
+/// the library is loaded, callers always go through table().
+/// Kernels accept unaligned pointers and any length, dst may alias x.
+namespace kernels {
+  enum InstructionSet
+  {
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_AVX512,
+    DIMENSION_ISA
+  };
+
+  struct Table
+  {
+    InstructionSet isa;
+
+    /// dst = x + y
+    void   (*add)(double* dst, const double* x, const double* y, size_t n);
+    /// dst = x - y
+    void   (*subtract)(double* dst, const double* x, const double* y, size_t n);
+    /// dst = x * scalar
+    void   (*scale)(double* dst, const double* x, double scalar, size_t n);
+    /// dst = dst + alpha * x
+    void   (*axpy)(double* dst, double alpha, const double* x, size_t n);
+    /// dst = alpha * x + beta * dst
+    void   (*axpby)(double* dst, double alpha, const double* x, double beta, size_t n);
+    /// dst = |x|
+    void   (*absolute)(double* dst, const double* x, size_t n);
+    /// dst = -1, 0 or 1 by sign of x, NaN gives 0
+    void   (*signum)(double* dst, const double* x, size_t n);
+    /// dst = min(max(x, lo), hi), NaN stays NaN
+    void   (*clamp)(double* dst, const double* x, const double* lo, const double* hi, size_t n);
+    /// dst = x < y ? x : y
+    void   (*minimum)(double* dst, const double* x, const double* y, size_t n);
+    /// dst = x > y ? x : y
+    void   (*maximum)(double* dst, const double* x, const double* y, size_t n);
+    /// dst = x * y
+    void   (*multiply)(double* dst, const double* x, const double* y, size_t n);
+    /// dst = dst + x * y
+    void   (*fma)(double* dst, const double* x, const double* y, size_t n);
+    /// sum(x[i] * y[i])
+    double (*dot)(const double* x, const double* y, size_t n);
+    /// sum(|x[i]|)
+    double (*norm1)(const double* x, size_t n);
+    /// sum(x[i] * x[i]), sqrt is left to caller
+    double (*norm2sq)(const double* x, size_t n);
+    /// max(|x[i]|), NaN coordinates are skipped
+    double (*normInf)(const double* x, size_t n);
+    /// norm1, norm2sq and normInf at once into res[0..2]
+    void   (*norms)(const double* x, size_t n, double* res);
+    /// sum(|x[i] - y[i]|)
+    double (*distance1)(const double* x, const double* y, size_t n);
+    /// sum((x[i] - y[i])^2), sqrt is left to caller
+    double (*distance2sq)(const double* x, const double* y, size_t n);
+    /// max(|x[i] - y[i]|), may stop early once result exceeds bound
+    double (*distanceInf)(const double* x, const double* y, size_t n, double bound);
+  };
+
+  /// \brief Kernels over float coordinates
+  ///
+  /// Elementwise kernels work in float to get twice as many lanes,
+  /// reductions widen every coordinate and accumulate in double.
+  struct FloatTable
+  {
+    /// dst = x + y
+    void   (*add)(float* dst, const float* x, const float* y, size_t n);
+    /// dst = x - y
+    void   (*subtract)(float* dst, const float* x, const float* y, size_t n);
+    /// dst = x * scalar
+    void   (*scale)(float* dst, const float* x, double scalar, size_t n);
+    /// dst = dst + alpha * x
+    void   (*axpy)(float* dst, double alpha, const float* x, size_t n);
+    /// dst = alpha * x + beta * dst
+    void   (*axpby)(float* dst, double alpha, const float* x, double beta, size_t n);
+    /// sum(x[i] * y[i])
+    double (*dot)(const float* x, const float* y, size_t n);
+    /// sum(|x[i]|)
+    double (*norm1)(const float* x, size_t n);
+    /// sum(x[i] * x[i]), sqrt is left to caller
+    double (*norm2sq)(const float* x, size_t n);
+    /// max(|x[i]|), NaN coordinates are skipped
+    double (*normInf)(const float* x, size_t n);
+    /// sum(|x[i] - y[i]|)
+    double (*distance1)(const float* x, const float* y, size_t n);
+    /// sum((x[i] - y[i])^2), sqrt is left to caller
+    double (*distance2sq)(const float* x, const float* y, size_t n);
+    /// max(|x[i] - y[i]|), may stop early once result exceeds bound
+    double (*distanceInf)(const float* x, const float* y, size_t n, double bound);
+    /// dst = (float)x
+    void   (*narrow)(float* dst, const double* x, size_t n);
+    /// dst = (double)x
+    void   (*widen)(double* dst, const float* x, size_t n);
+  };
+
+  /// \brief Kernels selected for the running CPU
+  const Table& table();
+
+  /// \brief Float kernels matching table()
+  const FloatTable& floatTable();
+
+  /// \brief dst = sum(coefs[k] * xs[k]), any xs[k] may alias dst
+  ///
+  /// Done block by block through table() kernels,
+  /// so every block stays in cache between terms.
+  void linearCombination(double* dst, size_t count,
+                         const double* coefs, const double* const* xs, size_t n);
+
+  /// \brief Widest instruction set supported by the running CPU
+  InstructionSet detect();
+
+  /// \brief Forces kernels of given instruction set
+  ///
+  /// \returns false if isa is not supported by the running CPU
+  bool select(InstructionSet isa);
+
+  const char* isaName(InstructionSet isa);
+}
+
+#endif // VECTOR_KERNELS_H_
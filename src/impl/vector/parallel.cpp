@@ -0,0 +1,537 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace /* PIMPL_NAMESPACE */ {
+  /// \brief parallel::setThreads() value
+  std::atomic<unsigned int> threadsLimit(0);
+
+  /// \brief Operands of kernel split into chunks
+  struct Args
+  {
+    const kernels::Table* serial;
+    double*       dst;
+    const double* x;
+    const double* y;
+    const double* z;
+    double        alpha;
+    double        beta;
+    size_t        n;
+  };
+
+  /// \brief Runs serial kernel on [begin, begin + len), returns partial result
+  typedef double (*ChunkFn)(const Args& args, size_t begin, size_t len);
+
+  enum Combine
+  {
+    COMBINE_NONE,
+    COMBINE_SUM,
+    COMBINE_MAX
+  };
+
+  /// \brief Tasks of one call, taken by threads in any order
+  class Job {
+  public:
+    Job(parallel::Task task, void* context, size_t tasks)
+      : m_task(task),
+        m_context(context),
+        m_tasks(tasks),
+        m_next(0),
+        m_helpers(0)
+    {  }
+
+    void work()
+    {
+      for (size_t index = m_next.fetch_add(1); index < m_tasks; index = m_next.fetch_add(1))
+        m_task(m_context, index);
+    }
+
+    /// \brief Workers beyond first helpers ones skip the job
+    void setHelpers(unsigned int helpers)
+    {
+      m_helpers.store(static_cast<int>(helpers), std::memory_order_relaxed);
+    }
+
+    /// \brief work() on a worker thread
+    void help()
+    {
+      if (m_helpers.fetch_sub(1) > 0)
+        work();
+    }
+
+  private:
+    parallel::Task      m_task;
+    void*               m_context;
+    size_t              m_tasks;
+    std::atomic<size_t> m_next;
+    std::atomic<int>    m_helpers;
+  };
+
+  /// \brief Chunks of one kernel call
+  struct Chunks
+  {
+    ChunkFn     fn;
+    const Args* args;
+    double*     partials;
+  };
+
+  void chunkTask(void* context, size_t chunk)
+  {
+    const Chunks& chunks = *static_cast<const Chunks*>(context);
+    const size_t begin = chunk * parallel::chunkSize;
+    const size_t n = chunks.args->n;
+    const size_t len = n - begin < parallel::chunkSize ? n - begin : parallel::chunkSize;
+    const double partial = chunks.fn(*chunks.args, begin, len);
+    if (chunks.partials)
+      chunks.partials[chunk] = partial;
+  }
+
+  /// \brief Worker threads, one less than cores, caller is the last one
+  ///
+  /// Only one job runs at a time, concurrent callers do their job alone.
+  /// Pool is never destroyed, so library unload does not wait for threads.
+  class Pool {
+  public:
+    static Pool* instance()
+    {
+      static Pool* pool = new(std::nothrow) Pool();
+      return pool;
+    }
+
+    unsigned int threads() const
+    {
+      return static_cast<unsigned int>(m_workers.size()) + 1;
+    }
+
+    void run(Job& job)
+    {
+      const unsigned int limit = threadsLimit.load(std::memory_order_relaxed);
+      std::unique_lock<std::mutex> submit(m_submit, std::try_to_lock);
+      if (!submit.owns_lock() || m_workers.empty() || limit == 1) {
+        job.work();
+        return;
+      }
+
+      job.setHelpers(limit == 0 || limit > threads() ? threads() - 1 : limit - 1);
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_busy = static_cast<unsigned int>(m_workers.size());
+        ++m_generation;
+      }
+      m_wake.notify_all();
+
+      job.work();
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_idle.wait(lock, [this] { return m_busy == 0; });
+      m_job = NULL;
+    }
+
+  private:
+    Pool()
+      : m_job(NULL),
+        m_generation(0),
+        m_busy(0)
+    {
+      const unsigned int cores = std::thread::hardware_concurrency();
+      for (unsigned int i = 1; i < cores; ++i) {
+        try {
+          m_workers.push_back(std::thread(&Pool::loop, this));
+        } catch (const std::system_error&) {
+          break;
+        }
+      }
+    }
+
+    void loop()
+    {
+      unsigned long seen = 0;
+      for (;;) {
+        Job* job;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_wake.wait(lock, [this, seen] { return m_generation != seen; });
+          seen = m_generation;
+          job = m_job;
+        }
+
+        job->help();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+          m_idle.notify_one();
+      }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex               m_submit;
+    std::mutex               m_mutex;
+    std::condition_variable  m_wake;
+    std::condition_variable  m_idle;
+    Job*                     m_job;
+    unsigned long            m_generation;
+    unsigned int             m_busy;
+  };
+
+  /// \brief Per-chunk results kept on stack up to this many chunks
+  static const size_t stackChunks = 1024;
+
+  double combine(Combine how, double acc, double partial)
+  {
+    if (how == COMBINE_SUM)
+      return acc + partial;
+    if (how == COMBINE_MAX)
+      return acc < partial ? partial : acc;
+    return acc;
+  }
+
+  double runChunks(ChunkFn fn, const Args& args, Combine how)
+  {
+    const size_t chunks = (args.n + parallel::chunkSize - 1) / parallel::chunkSize;
+
+    double stackPartials[stackChunks];
+    double* partials = NULL;
+    if (how != COMBINE_NONE) {
+      partials = chunks <= stackChunks ? stackPartials : new(std::nothrow) double[chunks];
+
+      // Same chunks in the same order on the calling thread give same result
+      if (!partials) {
+        double res = 0;
+        for (size_t begin = 0; begin < args.n; begin += parallel::chunkSize) {
+          const size_t len = args.n - begin < parallel::chunkSize ? args.n - begin : parallel::chunkSize;
+          res = combine(how, res, fn(args, begin, len));
+        }
+        return res;
+      }
+    }
+
+    Chunks context = { fn, &args, partials };
+    parallel::forEach(chunks, chunkTask, &context);
+
+    double res = 0;
+    for (size_t chunk = 0; partials && chunk < chunks; ++chunk)
+      res = combine(how, res, partials[chunk]);
+
+    if (partials != stackPartials)
+      delete[] partials;
+    return res;
+  }
+
+  /* ---- Chunk bodies ---- */
+
+  double addChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->add(a.dst + begin, a.x + begin, a.y + begin, len);
+    return 0;
+  }
+
+  double subtractChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->subtract(a.dst + begin, a.x + begin, a.y + begin, len);
+    return 0;
+  }
+
+  double scaleChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->scale(a.dst + begin, a.x + begin, a.alpha, len);
+    return 0;
+  }
+
+  double axpyChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->axpy(a.dst + begin, a.alpha, a.x + begin, len);
+    return 0;
+  }
+
+  double axpbyChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->axpby(a.dst + begin, a.alpha, a.x + begin, a.beta, len);
+    return 0;
+  }
+
+  double absoluteChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->absolute(a.dst + begin, a.x + begin, len);
+    return 0;
+  }
+
+  double signumChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->signum(a.dst + begin, a.x + begin, len);
+    return 0;
+  }
+
+  double clampChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->clamp(a.dst + begin, a.x + begin, a.y + begin, a.z + begin, len);
+    return 0;
+  }
+
+  double minimumChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->minimum(a.dst + begin, a.x + begin, a.y + begin, len);
+    return 0;
+  }
+
+  double maximumChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->maximum(a.dst + begin, a.x + begin, a.y + begin, len);
+    return 0;
+  }
+
+  double multiplyChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->multiply(a.dst + begin, a.x + begin, a.y + begin, len);
+    return 0;
+  }
+
+  double fmaChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->fma(a.dst + begin, a.x + begin, a.y + begin, len);
+    return 0;
+  }
+
+  double dotChunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->dot(a.x + begin, a.y + begin, len);
+  }
+
+  double norm1Chunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->norm1(a.x + begin, len);
+  }
+
+  double norm2sqChunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->norm2sq(a.x + begin, len);
+  }
+
+  double normInfChunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->normInf(a.x + begin, len);
+  }
+
+  /// \brief Writes three partials of chunk into a.dst
+  double normsChunk(const Args& a, size_t begin, size_t len)
+  {
+    a.serial->norms(a.x + begin, len, a.dst + 3 * (begin / parallel::chunkSize));
+    return 0;
+  }
+
+  double distance1Chunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->distance1(a.x + begin, a.y + begin, len);
+  }
+
+  double distance2sqChunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->distance2sq(a.x + begin, a.y + begin, len);
+  }
+
+  double distanceInfChunk(const Args& a, size_t begin, size_t len)
+  {
+    return a.serial->distanceInf(a.x + begin, a.y + begin, len, a.alpha);
+  }
+
+  /* ---- Table entries ---- */
+
+  Args makeArgs(double* dst, const double* x, const double* y, double alpha, double beta, size_t n,
+                const double* z = NULL)
+  {
+    Args args = { &kernels::table(), dst, x, y, z, alpha, beta, n };
+    return args;
+  }
+
+  void addParallel(double* dst, const double* x, const double* y, size_t n)
+  {
+    runChunks(addChunk, makeArgs(dst, x, y, 0, 0, n), COMBINE_NONE);
+  }
+
+  void subtractParallel(double* dst, const double* x, const double* y, size_t n)
+  {
+    runChunks(subtractChunk, makeArgs(dst, x, y, 0, 0, n), COMBINE_NONE);
+  }
+
+  void scaleParallel(double* dst, const double* x, double scalar, size_t n)
+  {
+    runChunks(scaleChunk, makeArgs(dst, x, NULL, scalar, 0, n), COMBINE_NONE);
+  }
+
+  void axpyParallel(double* dst, double alpha, const double* x, size_t n)
+  {
+    runChunks(axpyChunk, makeArgs(dst, x, NULL, alpha, 0, n), COMBINE_NONE);
+  }
+
+  void axpbyParallel(double* dst, double alpha, const double* x, double beta, size_t n)
+  {
+    runChunks(axpbyChunk, makeArgs(dst, x, NULL, alpha, beta, n), COMBINE_NONE);
+  }
+
+  void absoluteParallel(double* dst, const double* x, size_t n)
+  {
+    runChunks(absoluteChunk, makeArgs(dst, x, NULL, 0, 0, n), COMBINE_NONE);
+  }
+
+  void signumParallel(double* dst, const double* x, size_t n)
+  {
+    runChunks(signumChunk, makeArgs(dst, x, NULL, 0, 0, n), COMBINE_NONE);
+  }
+
+  void clampParallel(double* dst, const double* x, const double* lo, const double* hi, size_t n)
+  {
+    runChunks(clampChunk, makeArgs(dst, x, lo, 0, 0, n, hi), COMBINE_NONE);
+  }
+
+  void minimumParallel(double* dst, const double* x, const double* y, size_t n)
+  {
+    runChunks(minimumChunk, makeArgs(dst, x, y, 0, 0, n), COMBINE_NONE);
+  }
+
+  void maximumParallel(double* dst, const double* x, const double* y, size_t n)
+  {
+    runChunks(maximumChunk, makeArgs(dst, x, y, 0, 0, n), COMBINE_NONE);
+  }
+
+  void multiplyParallel(double* dst, const double* x, const double* y, size_t n)
+  {
+    runChunks(multiplyChunk, makeArgs(dst, x, y, 0, 0, n), COMBINE_NONE);
+  }
+
+  void fmaParallel(double* dst, const double* x, const double* y, size_t n)
+  {
+    runChunks(fmaChunk, makeArgs(dst, x, y, 0, 0, n), COMBINE_NONE);
+  }
+
+  double dotParallel(const double* x, const double* y, size_t n)
+  {
+    return runChunks(dotChunk, makeArgs(NULL, x, y, 0, 0, n), COMBINE_SUM);
+  }
+
+  double norm1Parallel(const double* x, size_t n)
+  {
+    return runChunks(norm1Chunk, makeArgs(NULL, x, NULL, 0, 0, n), COMBINE_SUM);
+  }
+
+  double norm2sqParallel(const double* x, size_t n)
+  {
+    return runChunks(norm2sqChunk, makeArgs(NULL, x, NULL, 0, 0, n), COMBINE_SUM);
+  }
+
+  double normInfParallel(const double* x, size_t n)
+  {
+    return runChunks(normInfChunk, makeArgs(NULL, x, NULL, 0, 0, n), COMBINE_MAX);
+  }
+
+  void normsParallel(const double* x, size_t n, double* res)
+  {
+    const size_t chunks = (n + parallel::chunkSize - 1) / parallel::chunkSize;
+
+    double stackPartials[3 * stackChunks];
+    double* partials = chunks <= stackChunks ? stackPartials : new(std::nothrow) double[3 * chunks];
+    if (!partials) {
+      res[0] = norm1Parallel(x, n);
+      res[1] = norm2sqParallel(x, n);
+      res[2] = normInfParallel(x, n);
+      return;
+    }
+
+    runChunks(normsChunk, makeArgs(partials, x, NULL, 0, 0, n), COMBINE_NONE);
+
+    res[0] = res[1] = res[2] = 0;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      res[0] = combine(COMBINE_SUM, res[0], partials[3 * chunk]);
+      res[1] = combine(COMBINE_SUM, res[1], partials[3 * chunk + 1]);
+      res[2] = combine(COMBINE_MAX, res[2], partials[3 * chunk + 2]);
+    }
+
+    if (partials != stackPartials)
+      delete[] partials;
+  }
+
+  double distance1Parallel(const double* x, const double* y, size_t n)
+  {
+    return runChunks(distance1Chunk, makeArgs(NULL, x, y, 0, 0, n), COMBINE_SUM);
+  }
+
+  double distance2sqParallel(const double* x, const double* y, size_t n)
+  {
+    return runChunks(distance2sqChunk, makeArgs(NULL, x, y, 0, 0, n), COMBINE_SUM);
+  }
+
+  double distanceInfParallel(const double* x, const double* y, size_t n, double bound)
+  {
+    // Every chunk stops on its own once it exceeds bound
+    return runChunks(distanceInfChunk, makeArgs(NULL, x, y, bound, 0, n), COMBINE_MAX);
+  }
+
+  #define PARALLEL_TABLE(isa)                                                        \
+    { isa,                                                                           \
+      addParallel, subtractParallel, scaleParallel, axpyParallel, axpbyParallel,     \
+      absoluteParallel, signumParallel, clampParallel, minimumParallel,              \
+      maximumParallel, multiplyParallel, fmaParallel,                                \
+      dotParallel, norm1Parallel, norm2sqParallel, normInfParallel, normsParallel,   \
+      distance1Parallel, distance2sqParallel, distanceInfParallel }
+
+  /// \brief Chunked kernels, same for every instruction set but its tag
+  const kernels::Table parallelTables[kernels::DIMENSION_ISA] = {
+    PARALLEL_TABLE(kernels::ISA_SCALAR),
+    PARALLEL_TABLE(kernels::ISA_SSE2),
+    PARALLEL_TABLE(kernels::ISA_AVX2),
+    PARALLEL_TABLE(kernels::ISA_AVX512),
+  };
+
+  #undef PARALLEL_TABLE
+
+  /// \brief Default is where memory bandwidth of one core runs out
+  std::atomic<size_t> thresholdDim(1 << 20);
+} /* PIMPL_NAMESPACE */
+
+size_t parallel::threshold()
+{
+  return thresholdDim.load(std::memory_order_relaxed);
+}
+
+void parallel::setThreshold(size_t dim)
+{
+  thresholdDim.store(dim, std::memory_order_relaxed);
+}
+
+const kernels::Table& parallel::tableFor(size_t n)
+{
+  const kernels::Table& serial = kernels::table();
+  if (n < threshold() || n <= chunkSize)
+    return serial;
+
+  // Chunked even without workers, so reductions do not depend on thread count
+  return parallelTables[serial.isa];
+}
+
+void parallel::forEach(size_t tasks, Task task, void* context)
+{
+  Job job(task, context, tasks);
+  Pool* pool = Pool::instance();
+  if (pool && tasks > 1)
+    pool->run(job);
+  else
+    job.work();
+}
+
+unsigned int parallel::concurrency()
+{
+  Pool* pool = Pool::instance();
+  const unsigned int threads = pool ? pool->threads() : 1;
+  const unsigned int limit = threadsLimit.load(std::memory_order_relaxed);
+  return limit == 0 || limit > threads ? threads : limit;
+}
+
+void parallel::setThreads(unsigned int threads)
+{
+  threadsLimit.store(threads, std::memory_order_relaxed);
+}
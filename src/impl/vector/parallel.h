@@ -0,0 +1,47 @@
+#ifndef VECTOR_PARALLEL_H_
+#define VECTOR_PARALLEL_H_
+
+#include <cstddef>
+#include "kernels.h"
+
+/// \brief Multi-threaded flavour of kernels::table()
+///
+/// Coordinates are split into chunks of fixed size which are handed
+/// to a pool of worker threads. Reductions add per-chunk results in
+/// chunk order, so they give the same bits for any number of threads.
+namespace parallel {
+  /// \brief Coordinates processed by one task
+  static const size_t chunkSize = 64 * 1024;
+
+  /// \brief Smallest dimension worth splitting across threads
+  size_t threshold();
+  void setThreshold(size_t dim);
+
+  /// \brief Kernels for vectors of n coordinates
+  ///
+  /// Plain kernels::table() under threshold(), chunked kernels otherwise.
+  /// Chunks run on the calling thread alone if the pool has no workers
+  /// or setThreads(1) is set, so results match multi-threaded ones.
+  const kernels::Table& tableFor(size_t n);
+
+  /// \brief Body of one task, index is in [0, tasks)
+  typedef void (*Task)(void* context, size_t index);
+
+  /// \brief Runs every task once on the pool and waits for all of them
+  ///
+  /// Tasks are taken by threads in any order, so each one must write
+  /// its own part of the result. Runs on the calling thread alone
+  /// if the pool has no workers or is busy with another caller.
+  void forEach(size_t tasks, Task task, void* context);
+
+  /// \brief Threads forEach() may run tasks on, caller included
+  unsigned int concurrency();
+
+  /// \brief Limits threads taking part in one call, caller included
+  ///
+  /// 0 lets every worker of the pool take part, 1 keeps all work
+  /// on the calling thread. Pool itself keeps its size.
+  void setThreads(unsigned int threads);
+}
+
+#endif // VECTOR_PARALLEL_H_
@@ -0,0 +1,70 @@
+#include "storage.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(_WIN32)
+  #include <malloc.h>
+#else
+  #include <sys/mman.h>
+#endif
+
+namespace /* PIMPL_NAMESPACE */ {
+  std::atomic<unsigned long long> allocationsCount(0);
+
+  void* allocateAligned(size_t bytes)
+  {
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, bytes >= storage::hugeThreshold ? storage::hugePage : storage::cacheLine);
+#else
+    void* ptr = NULL;
+    if (bytes >= storage::hugeThreshold && posix_memalign(&ptr, storage::hugePage, bytes) == 0) {
+#if defined(MADV_HUGEPAGE)
+      // Only a hint, kernels without transparent huge pages keep small ones
+      madvise(ptr, bytes & ~(storage::hugePage - 1), MADV_HUGEPAGE);
+#endif
+      return ptr;
+    }
+
+    // Huge alignment may be refused for lack of address space, small one is enough
+    if (posix_memalign(&ptr, storage::cacheLine, bytes) != 0)
+      return NULL;
+    return ptr;
+#endif
+  }
+} /* PIMPL_NAMESPACE */
+
+void* storage::allocate(size_t bytes)
+{
+  void* ptr = allocateAligned(bytes ? bytes : 1);
+  if (ptr)
+    allocationsCount.fetch_add(1, std::memory_order_relaxed);
+  return ptr;
+}
+
+void storage::release(void* ptr)
+{
+#if defined(_WIN32)
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+unsigned long long storage::allocations()
+{
+  return allocationsCount.load(std::memory_order_relaxed);
+}
+
+size_t storage::alignmentOf(void const* ptr)
+{
+  const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  if (address == 0)
+    return 0;
+
+  size_t res = 1;
+  while (res < cacheLine && (address & res) == 0)
+    res <<= 1;
+  return res;
+}
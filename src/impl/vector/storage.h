@@ -0,0 +1,41 @@
+#ifndef VECTOR_STORAGE_H_
+#define VECTOR_STORAGE_H_
+
+#include <cstddef>
+
+/// \brief Coordinates memory of vector implementations
+///
+/// Blocks start on a cache line, so SIMD loads of coordinates never
+/// split lines. Large blocks are aligned to huge page and advised to
+/// the kernel as transparent huge page candidates where supported,
+/// which cuts TLB misses of long sweeps over them.
+namespace storage {
+  /// \brief Alignment of every block
+  static const size_t cacheLine = 64;
+
+  /// \brief Alignment of blocks of at least hugeThreshold bytes
+  static const size_t hugePage = 2 * 1024 * 1024;
+  static const size_t hugeThreshold = 2 * hugePage;
+
+  /// \returns uninitialized block or NULL, free it with release()
+  void* allocate(size_t bytes);
+
+  void release(void* ptr);
+
+  /// \brief Successful allocate() calls so far, from any thread
+  ///
+  /// Blocks do not go through global operator new, so counters
+  /// replacing it do not see them.
+  unsigned long long allocations();
+
+  /// \brief Largest power of two up to cacheLine dividing address
+  size_t alignmentOf(void const* ptr);
+
+  /// \brief bytes rounded up to multiple of cacheLine
+  inline size_t alignUp(size_t bytes)
+  {
+    return (bytes + cacheLine - 1) & ~(cacheLine - 1);
+  }
+}
+
+#endif // VECTOR_STORAGE_H_
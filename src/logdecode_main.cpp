@@ -0,0 +1,196 @@
+#include <QByteArray>
+#include <QFile>
+#include <QTime>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "impl/log/logformat.h"
+
+/// \brief Turns binary log of ILog::initBinary() into text log
+///
+/// Usage: LogDecode <binary log> [text log]
+/// Text goes to stdout if no text log is given. Lines are the same
+/// ILog::init() would write, "[hh:mm:ss.zzz] file:line [function] message".
+
+namespace /* PIMPL_NAMESPACE */ {
+  struct Format
+  {
+    std::string location;
+    std::string format;
+  };
+
+  /// \brief Reads value at pos of data of size bytes, moves pos past it
+  template <typename T>
+  bool readRaw(const char* data, size_t size, size_t& pos, T& value)
+  {
+    if (size - pos < sizeof(value))
+      return false;
+    std::memcpy(&value, data + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+  }
+
+  /// \brief Writes text of binary log records to file
+  class Decoder {
+  public:
+    explicit Decoder(QFile& out)
+      : m_out(out),
+        m_sessionTime(0),
+        m_sessionMsecs(0)
+    {  }
+
+    /// \returns false if data is not a complete binary log
+    bool decode(const char* data, size_t size)
+    {
+      const bool complete = records(data, size);
+      m_out.write(m_text);
+      m_text.clear();
+      return complete;
+    }
+
+  private:
+    bool records(const char* data, size_t size)
+    {
+      size_t pos = 0;
+      while (pos < size) {
+        if (size - pos >= logformat::sessionSize &&
+            std::memcmp(data + pos, logformat::magic, sizeof(logformat::magic)) == 0) {
+          pos += sizeof(logformat::magic);
+          int64_t time = 0;
+          int32_t msecs = 0;
+          readRaw(data, size, pos, time);
+          readRaw(data, size, pos, msecs);
+          m_sessionTime = time;
+          m_sessionMsecs = msecs;
+          m_formats.clear();
+          continue;
+        }
+
+        if (pos == 0) {
+          std::fprintf(stderr, "Not a binary log\n");
+          return false;
+        }
+
+        uint32_t length;
+        uint8_t kind;
+        if (!readRaw(data, size, pos, length) || !readRaw(data, size, pos, kind) ||
+            size - pos < length) {
+          std::fprintf(stderr, "Log is cut at byte %lu\n", static_cast<unsigned long>(pos));
+          return false;
+        }
+
+        if (!record(kind, data + pos, length)) {
+          std::fprintf(stderr, "Bad record at byte %lu\n", static_cast<unsigned long>(pos));
+          return false;
+        }
+        pos += length;
+
+        if (m_text.size() >= maxText) {
+          m_out.write(m_text);
+          m_text.clear();
+        }
+      }
+      return true;
+    }
+
+    bool record(uint8_t kind, const char* data, size_t size)
+    {
+      size_t pos = 0;
+      uint32_t id;
+      int64_t time;
+
+      switch (kind) {
+      case logformat::RECORD_FORMAT: {
+        if (!readRaw(data, size, pos, id))
+          return false;
+        const char* end = static_cast<const char*>(std::memchr(data + pos, '\0', size - pos));
+        if (!end)
+          return false;
+        Format& format = m_formats[id];
+        format.location.assign(data + pos, end);
+        format.format.assign(end + 1, data + size);
+        return true;
+      }
+
+      case logformat::RECORD_TEXT:
+        if (!readRaw(data, size, pos, time))
+          return false;
+        line(time, std::string(data + pos, size - pos));
+        return true;
+
+      case logformat::RECORD_MESSAGE: {
+        if (!readRaw(data, size, pos, id) || !readRaw(data, size, pos, time))
+          return false;
+        std::map<uint32_t, Format>::const_iterator format = m_formats.find(id);
+        if (format == m_formats.end()) {
+          line(time, "Unknown log format " + std::to_string(id));
+          return true;
+        }
+        std::string text = format->second.location;
+        logformat::appendMessage(text, format->second.format.c_str(), data + pos, size - pos);
+        line(time, text);
+        return true;
+      }
+
+      default:
+        return false;
+      }
+    }
+
+    void line(int64_t time, const std::string& text)
+    {
+      const int msecs = logformat::msecsOfDay(time, m_sessionTime, m_sessionMsecs);
+      m_text.append("[");
+      m_text.append(QTime::fromMSecsSinceStartOfDay(msecs).toString("hh:mm:ss.zzz").toUtf8());
+      m_text.append("] ");
+      m_text.append(text.data(), static_cast<int>(text.size()));
+      m_text.append("\n");
+    }
+
+    /// \brief Text is written in parts of about this many bytes
+    static const int maxText = 64 * 1024;
+
+    QFile&                     m_out;
+    QByteArray                 m_text;
+    long long                  m_sessionTime;
+    int                        m_sessionMsecs;
+    std::map<uint32_t, Format> m_formats;
+  };
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2 || argc > 3) {
+    std::fprintf(stderr, "Usage: %s <binary log> [text log]\n", argv[0]);
+    return 2;
+  }
+
+  const QString inName(argv[1]);
+  QFile in(inName);
+  if (!in.open(QIODevice::ReadOnly)) {
+    std::fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 2;
+  }
+  const QByteArray data = in.readAll();
+  in.close();
+
+  QFile out;
+  if (argc == 3) {
+    out.setFileName(QString(argv[2]));
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      std::fprintf(stderr, "Cannot open %s\n", argv[2]);
+      return 2;
+    }
+  } else if (!out.open(stdout, QIODevice::WriteOnly)) {
+    std::fprintf(stderr, "Cannot open stdout\n");
+    return 2;
+  }
+
+  Decoder decoder(out);
+  const bool complete = decoder.decode(data.constData(), static_cast<size_t>(data.size()));
+  out.close();
+  return complete ? 0 : 1;
+}